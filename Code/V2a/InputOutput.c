@@ -29,14 +29,17 @@
 
 #include "includes.h"
 
+//Servo output state asked for with SetPWMOutput()
+static volatile bool	PwmOutReq;
+
 void IOInit(void){
 
 	/* Init HW  Systems*/	
 	timerInit();
 	a2dInit();
 	
-	//Turn on PWM Pin
-	PWM_ON;
+	//Turn on PWM Pin at the first compare match
+	SetPWMOutput(TRUE);
 	
 	//Set servo to mid position
 	SetPWMDuty(PWM_CENTER_DFLT);
@@ -59,11 +62,36 @@ void IOInit(void){
 
 void SetPWMDuty(uint16_t highTime){
 
+		//OCR1A is double buffered in mode 14, the new duty starts
+		//	with the next frame and never cuts a pulse short
 		OCR1AH = highTime>>8;
 		OCR1AL = highTime&0x00FF;
 
 } /* end timerSetPWMDuty */
 
+void SetPWMOutput(bool on){
+
+	//Local variables
+	uint8_t		sreg;
+	
+	//The pin is switched by the next OC1A compare match, right after
+	//	the pulse ends, so a pulse is never started or ended early
+	sreg		= SREG;
+	INTR_OFF;
+	PwmOutReq	= on;
+	TIFR		= (1<<OCF1A);
+	TIMSK		|= (1<<OCIE1A);
+	SREG		= sreg;
+
+} /* end SetPWMOutput */
+
+bool GetPWMOutput(void){
+
+	//Requested state, the pin follows within one frame
+	return PwmOutReq;
+
+} /* end GetPWMOutput */
+
 void SetPWMPeriod(uint16_t period){
 
 	ICR1H = period>>8;
@@ -128,3 +156,21 @@ DIR_PIN		GetDirPin  	(void){
 		return REV;
 
 }//end GetDirPin
+
+//Interrupt service routine for TOC1 compare match A
+SIGNAL(SIG_OUTPUT_COMPARE1A){
+/*	Desc:		Switches the servo pin as asked for by SetPWMOutput().
+*				Runs right after the pulse ends, so the pin is low.
+*	Args:		None.
+*	Ret:		None.
+*	Side E:		Disables itself; one shot per request.
+*/
+
+	if( PwmOutReq )
+		PWM_ON;
+	else
+		PWM_OFF;
+	
+	TIMSK &= ~(1<<OCIE1A);
+
+}//end SIG_OUTPUT_COMPARE1A
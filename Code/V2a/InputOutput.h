@@ -96,6 +96,8 @@ void IOInit				(void);
 //Servo Control
 void SetPWMDuty			(uint16_t	highCount);
 void SetPWMPeriod		(uint16_t	period);
+void SetPWMOutput		(bool		on);
+bool GetPWMOutput		(void);
 //Inputs
 KEY_POS		GetKeyPos	(void);
 SWITCH_POS	GetSwitchPos(void);
@@ -1251,14 +1251,11 @@ SIGNAL(SIG_OUTPUT_COMPARE2){
 			//Add the minimum step size to the duty cycle
 			CurrentDutyCycle += PWM_ADJ_RESOLUTION;
 			
-			//Wait until pin is low
-			while( TCNT1 <= OCR1A ){};
-			
-			//Write Value to Servo
+			//Write Value to Servo, takes effect next frame
 			SetPWMDuty(CurrentDutyCycle);
 			
-			//turn on PWM
-			PWM_ON;
+			//turn on PWM at the end of this frame's pulse
+			SetPWMOutput(TRUE);
 			
 			SpeedTimer = ServoParamsRam.Speed;
 		
@@ -1268,14 +1265,11 @@ SIGNAL(SIG_OUTPUT_COMPARE2){
 			//Subtract the minimum step size to the duty cycle
 			CurrentDutyCycle -= PWM_ADJ_RESOLUTION;
 			
-			//Wait until pin is low
-			while( TCNT1 <= OCR1A ){};
-			
-			//Write Value to Servo
+			//Write Value to Servo, takes effect next frame
 			SetPWMDuty(CurrentDutyCycle);
 			
-			//turn on PWM
-			PWM_ON;
+			//turn on PWM at the end of this frame's pulse
+			SetPWMOutput(TRUE);
 		
 			//Reset speed counter
 			SpeedTimer = ServoParamsRamPtr->Speed;
@@ -1284,7 +1278,7 @@ SIGNAL(SIG_OUTPUT_COMPARE2){
 		else{
 		
 			//Check to see if PWM is on and that we aren't counting yet
-			if( (DDRB & (1<<PB1)) && !HumCount ){
+			if( GetPWMOutput() && !HumCount ){
 			
 				//PWM is on, we haven't started timing, so reset the counter
 				HumCount = HUM_TIMEOUT;
@@ -1308,12 +1302,9 @@ SIGNAL(SIG_OUTPUT_COMPARE2){
 							||	( CurrentState == STATE_LOCKED ) 
 							||	( CurrentState == STATE_DEMO   ) ) ){
 			
-			//We've timed out and therefore need to shut off the PWM
-			//First we need to wait until the OC2B pin is low
-			while( TCNT1 <= OCR1A ){};
-			
-			//We've checked to make sure pin is low, turn off PWM
-			PWM_OFF;
+			//We've timed out and therefore need to shut off the PWM;
+			//	it goes off at the end of this frame's pulse
+			SetPWMOutput(FALSE);
 			
 		}//end if
 	
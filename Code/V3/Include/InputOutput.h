@@ -9,23 +9,51 @@
 //A2dC counts corrosponding to voltages for switch
 #define UP_MIN_VOLTS		3.0
 #define DOWN_MAX_VOLTS		2.0
-#define UP_MIN_COUNT		(uint16_t)((UP_MIN_VOLTS/5.0)*1024.0)
-#define DOWN_MAX_COUNT		(uint16_t)((DOWN_MAX_VOLTS/5.0)*1024.0)
+#define UP_MIN_COUNT		(uint16_t)((UP_MIN_VOLTS/5.0)*A2D_FULL_SCALE)
+#define DOWN_MAX_COUNT		(uint16_t)((DOWN_MAX_VOLTS/5.0)*A2D_FULL_SCALE)
 //Switch A2D channel
 #define A2D_SWITCH_CH		1
 #define A2D_SPEED_CH		2
 #define A2D_OPEN_CH			3
 #define A2D_CLSD_CH			4
-//Defines for servo counts
-#define PWM_OPEN_LIM		2250							//ISR counts
-#define PWM_CLSD_LIM		750								//ISR Counts
+//Defines for servo pulse widths
+#define PWM_OPEN_LIM		2250							//x 1 us, PWM_US() for TOC1 counts
+#define PWM_CLSD_LIM		750								//x 1 us
 #define PWM_OPEN_DFLT		1750
 #define PWM_CLOSED_DFLT		1250
 #define PWM_CENTER_DFLT		1500
 #define PWM_SPEED_DFLT		4						// x 1ms between each servo step
+//Frame rate, set at build time.  Analog servos such as the HS-322HD
+//	can be damaged by the faster rates, they are for digital servos only.
+#ifndef PWM_FRAME_DFLT
+#define PWM_FRAME_DFLT		SERVO_FRAME_50HZ
+#endif
+//Frame lengths, x 1 us, all longer than PWM_OPEN_LIM plus the a2d sleep
+//	guard.  50 Hz is 8 ms with PWM_HIRES.
+#define PWM_FRAME_200HZ		5000
+#define PWM_FRAME_333HZ		3000
+//Servo channels: 0 is OC1A (PB1), 1 is OC1B (PB2), 2 and 3 are
+//	software PWM on PD6 and PD7
+#ifndef PWM_CH_NUM
+#define PWM_CH_NUM			1
+#endif
+#if PWM_CH_NUM < 1 || PWM_CH_NUM > 4
+#error "PWM_CH_NUM must be 1 to 4"
+#endif
+#define PWM_SW_NUM			((PWM_CH_NUM > 2) ? PWM_CH_NUM - 2 : 0)
+#define PWM_SW_PINS			( 1<<PD6 | 1<<PD7 )
+//Software PWM wakes this long before a pulse ends and waits out the
+//	rest on TCNT1, TOC1 counts.  It covers the TOC0 overflow ISR entry,
+//	~30 cycles, to the first TCNT1 read, so the wait is at most this.
+//	The pulse end is only that exact when no other ISR is running at
+//	the wake.  One that is holds it up, and the pulse ends late by
+//	about as long, 62 us after a 60 us ISR.
+#define PWM_SW_LEAD			PWM_US(6)
 //Turn on/off pwm
 #define PWM_ON				(DDRB |= (1<<PB1))
 #define PWM_OFF				(DDRB &= ~(1<<PB1))
+#define PWM_B_ON			(DDRB |= (1<<PB2))
+#define PWM_B_OFF			(DDRB &= ~(1<<PB2))
 //added 10/14/05
 #define GET_RESET_INPUT		(PINB & (1<<PB3))
 
@@ -52,6 +80,7 @@ typedef struct{
 	SWITCH_POS	SwitchPosOld;
 	SWITCH_POS	SwitchPosNew;
 	uint32_t	SwitchTimeNew;
+	uint32_t	SwitchTimeUs;	//timerGetUs() of the first sample at the new position
 }SWITCH_EVENT_STRUCT;
 
 typedef struct{
@@ -59,23 +88,45 @@ typedef struct{
 	KEY_POS		KeyPosOld;
 	KEY_POS		KeyPosNew;
 	uint32_t	KeyTimeNew;
+	uint32_t	KeyTimeUs;		//timerGetUs() of the first sample at the new position
 }KEY_EVENT_STRUCT;
 
+typedef enum{
+	SERVO_FRAME_50HZ	= 1,	//analog servos
+	SERVO_FRAME_200HZ	= 2,	//digital servos
+	SERVO_FRAME_333HZ	= 3
+}SERVO_FRAME;
+
+//Limits per side, channel 0 on a single servo cover
 typedef struct{
-	uint16_t	UpperLimit;
-	uint16_t	LowerLimit;
+	uint16_t	UpperLimit[PWM_CH_NUM];
+	uint16_t	LowerLimit[PWM_CH_NUM];
 	uint16_t	Speed;
+	SERVO_FRAME	FrameRate;
 }SERVO_PARAMS;
 
+//How a side's limits differ from the potentiometer limits
+typedef struct{
+	int16_t		UpperTrim;		//x 1 us, added to the limit
+	int16_t		LowerTrim;
+	bool		Mirror;			//servo faces the other way, limits mirrored about PWM_CENTER_DFLT
+}SERVO_SIDE;
+
 //Prototypes
 //hardware Setup
 void IOInit				(void);
 //Servo Control
-void SetPWMDuty			(uint16_t	highCount);
+void SetPWMDuty			(uint8_t ch, uint16_t	highCount);
 void SetPWMPeriod		(uint16_t	period);
+uint16_t SetPWMFrame	(SERVO_FRAME frame);
+void SetPWMOutput		(uint8_t ch, bool		on);
+bool GetPWMOutput		(uint8_t ch);
+uint16_t GetPWMHighMax	(void);
+void PWMFrameStart		(void);
 //Inputs
 KEY_POS		GetKeyPos	(void);
 SWITCH_POS	GetSwitchPos(void);
+SWITCH_POS	GetSwitchPosTime(uint32_t *us);
 DIR_PIN		GetDirPin	(void);
 
 #endif 	//#ifndef INPUTOUTPUT_H
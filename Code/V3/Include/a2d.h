@@ -24,10 +24,55 @@
 #include "includes.h"
 
 /* defines */
+//Number of channels converted by the background scan
+#define A2D_SCAN_NUM		4
+//Number of mux channels on the atmega8
+#define A2D_MUX_NUM			8
+//Marks a mux channel that is not part of the scan
+#define A2D_NO_SLOT			0xFF
+//Oversampling, 16 x 10 bit samples decimated to 12 bits
+#define A2D_OVERSAMPLE		16
+#define A2D_DECIMATE_SHIFT	2
+//All results are scaled to 12 bits
+#define A2D_FULL_SCALE		4096.0
+//Decimated results kept per channel, must be a power of 2
+#define A2D_RING_SIZE		4
+//Default sample periods, x 1 ms.  The switch is sampled fast, so a
+//	flick of it is seen quickly.
+#define A2D_SWITCH_PERIOD	5
+#define A2D_POT_PERIOD		20
+//A2d clock prescaler bits for each profile
+#define A2D_PRECISE_PS		(1<<ADPS2 | 1<<ADPS1)	//F_OSC/64 = 125 kHz
+#define A2D_FAST_PS			(1<<ADPS2)				//F_OSC/16 = 500 kHz
+//Time a sleep conversion halts TOC1 and TOC2 for each profile, x 1 us:
+//	13 a2d clocks, and on average half of one to the edge it starts on
+#define A2D_PRECISE_HALT	108
+#define A2D_FAST_HALT		27
+//TOC1 counts that must remain before the next servo pulse to start a
+//	sleep conversion; 13 a2d clocks at F_OSC/64 is 104 us
+#define A2D_SLEEP_GUARD		PWM_US(250)
+
+/* types */
+typedef enum{
+	A2D_MODE_RAW		= 1,	//every conversion is a result
+	A2D_MODE_OVERSAMPLE	= 2,	//A2D_OVERSAMPLE conversions per result
+	A2D_MODE_SLEEP		= 3		//converted on request in ADC noise reduction sleep
+}A2D_MODE;
+
+typedef enum{
+	A2D_PROFILE_PRECISE	= 1,	//10 bits, 104 us per conversion
+	A2D_PROFILE_FAST	= 2		//8 bits left adjusted, 26 us per conversion
+}A2D_PROFILE;
 
 
 /* prototypes */
-void a2dInit(void);
-uint16_t a2dSample(uint8_t channel);
+void 		a2dInit		(void);
+uint16_t	a2dGetSample(uint8_t channel);
+uint16_t	a2dGetSampleTime(uint8_t channel, uint32_t *us);
+uint16_t	a2dGetOlder	(uint8_t channel, uint8_t age);
+uint8_t		a2dGetCount	(uint8_t channel);
+void		a2dSetPeriod(uint8_t channel, uint16_t period);
+uint16_t	a2dTick		(uint8_t elapsed);
+void		a2dSleepService	(void);
 
 #endif /* #ifndef A2D_H */
@@ -0,0 +1,32 @@
+/*	File:	filter.h
+*	Desc:	This is the include file for the input
+*			filter routines in filter.c for the
+*			AutoMotion project.
+*	Proj:	AutoMotion
+*/
+
+#ifndef FILTER_H
+#define FILTER_H
+
+/* includes */
+#include "includes.h"
+
+/* defines */
+//Filter coefficients are Q8.8, FILTER_ONE passes the input through
+#define FILTER_ONE			256
+#define FILTER_SHIFT		8
+
+/* types */
+typedef struct{
+	uint32_t	State;		//filtered input, Q.8
+	uint16_t	Output;		//last value that moved past the deadband
+	uint16_t	Alpha;		//Q8.8 coefficient, 1 - FILTER_ONE
+	uint16_t	Deadband;	//input counts needed to move Output
+}FILTER_CH;
+
+/* prototypes */
+void		filterInit		(FILTER_CH *filter, uint16_t alpha, uint16_t deadband, uint16_t value);
+bool		filterUpdate	(FILTER_CH *filter, uint16_t sample);
+uint16_t	filterOutput	(const FILTER_CH *filter);
+
+#endif /* #ifndef FILTER_H */
@@ -23,6 +23,7 @@
 #include <avr/signal.h>
 #include <avr/eeprom.h>
 #include <avr/wdt.h>
+#include <avr/sleep.h>
 #include <inttypes.h>
 #include <stdlib.h>
 
@@ -31,6 +32,10 @@ typedef uint8_t bool;
 /* Project related include files */
 #include "timer.h"
 #include "a2d.h"
+#include "filter.h"
+#include "swtimer.h"
+#include "sched.h"
+#include "motion.h"
 #include "InputOutput.h"
 
 /* Project wide definitions */
@@ -0,0 +1,87 @@
+/*	File:	motion.h
+*	Desc:	This is the include file for the servo
+*			motion engine in motion.c for the
+*			AutoMotion project.
+*	Proj:	AutoMotion
+*/
+
+#ifndef MOTION_H
+#define MOTION_H
+
+/* includes */
+#include "includes.h"
+
+/* defines */
+//Minimum servo step, x 1 us, every Speed + 1 ms
+#define PWM_ADJ_RESOLUTION	10
+//Positions, speeds and accelerations are Q16
+#define MOTION_SHIFT		16
+//Default acceleration, x 1 us / 20 ms / 20 ms, Q16.  The engine steps
+//	once per frame and scales it to the frame length.
+#define MOTION_ACCEL_DFLT	((uint32_t)8<<MOTION_SHIFT)
+//Top speed limit, in acceleration steps
+#define MOTION_VMAX_LIM		1000
+//Plan segments per channel, split between the channels so the plans
+//	take the same RAM however many there are, and the longest move
+//	planned, 2048 frames at 50 Hz.  In frames it is also kept to what
+//	MOTION_PLAN_SIZE segments of 255 frames hold.
+#define MOTION_PLAN_SIZE	(40 / PWM_CH_NUM)
+#define MOTION_PLAN_MS		40960UL	//x 1 ms
+//Most waypoints in one path
+#define MOTION_PATH_SIZE	4
+//Plan steps are Q7, +-255 us / frame
+#define MOTION_PLAN_SHIFT	7
+//Command, waypoint and event queue lengths, powers of 2.  The command
+//	queue holds a synchronized group of every channel.
+#define MOTION_CMD_Q_SIZE	((PWM_CH_NUM > 2) ? 8 : 4)
+#define MOTION_WAY_Q_SIZE	8
+#define MOTION_EVENT_Q_SIZE	8
+//PWM is turned off this long after the servo arrives, at most.  The
+//	time is worked out for each move: HUM_MIN, plus HUM_SETTLE ms per
+//	100 us of travel, plus the time a servo that slews at SERVO_SLEW
+//	needs to catch up with a move that was faster than that.
+#define HUM_TIMEOUT			3000	//3 sec. timeout
+#define HUM_MIN				200		//x 1 ms
+#define HUM_SETTLE			100		//x 1 ms / 100 us
+#define SERVO_SLEW			3		//x 1 us / ms, ~0.2 s / 60 deg
+
+/* types */
+typedef enum{
+	MOTION_PROFILE_TRAP		= 1,	//trapezoid, can be retargeted smoothly
+	MOTION_PROFILE_SCURVE	= 2		//smootherstep, jerk limited
+}MOTION_PROFILE;
+
+typedef enum{
+	MOTION_EVENT_NONE		= 0,
+	MOTION_EVENT_DONE		= 1,	//command reached its target
+	MOTION_EVENT_ABORT		= 2		//command replaced before it got there
+}MOTION_EVENT;
+
+//Path waypoint
+typedef struct{
+	uint16_t	Duty;		//x 1 us
+	uint16_t	Speed;		//top speed on the way to it, as SERVO_PARAMS Speed
+}MOTION_WAYPOINT;
+
+/* prototypes */
+void			motionInit		(uint16_t duty);
+void			motionSetService(void (*service)(void));
+bool			motionMoveTo	(uint8_t ch, uint16_t duty, MOTION_PROFILE profile);
+bool			motionStop		(uint8_t ch);
+bool			motionPark		(uint8_t ch);
+bool			motionMovePath	(uint8_t ch, const MOTION_WAYPOINT *path, uint8_t num);
+bool			motionMoveSync	(const uint16_t *duty, MOTION_PROFILE profile);
+bool			motionParkSync	(void);
+void			motionSetPark	(uint8_t ch, uint16_t duty);
+bool			motionService	(void);
+MOTION_EVENT	motionGetEvent	(uint8_t *ch, uint16_t *duty);
+uint16_t		motionGetTarget	(uint8_t ch);
+void			motionSetSpeed	(uint16_t speed);
+void			motionSetAccel	(uint32_t accel);
+void			motionSetFrame	(uint16_t us);
+void			motionSetHold	(uint16_t ms, uint8_t burst);
+uint32_t		motionGetPulses	(uint8_t ch);
+bool			motionBusy		(uint8_t ch);
+void			motionFrame		(void);
+
+#endif /* #ifndef MOTION_H */
@@ -0,0 +1,35 @@
+/*	File:	sched.h
+*	Desc:	This is the include file for the cooperative
+*			task scheduler in sched.c for the AutoMotion
+*			project.
+*	Proj:	AutoMotion
+*/
+
+#ifndef SCHED_H
+#define SCHED_H
+
+/* includes */
+#include "includes.h"
+
+/* defines */
+//No task is due
+#define SCHED_NEVER		0xFFFF
+
+/* types */
+typedef struct{
+	void			(*Func)(void);	//runs to completion
+	uint16_t		Period;			//x 1 ms, 0 runs only when signalled
+	uint16_t		Countdown;		//ms until it is made ready
+	volatile bool	Ready;
+	//Statistics
+	uint16_t		Runs;			//times run
+	uint32_t		BusyUs;			//total run time, x 1 us
+}SCHED_TASK;
+
+/* prototypes */
+void		schedInit	(SCHED_TASK *tasks, uint8_t num, void (*idle)(void));
+void		schedReady	(uint8_t task);
+uint16_t	schedTick	(uint8_t elapsed);
+void		schedRun	(void);
+
+#endif /* #ifndef SCHED_H */
@@ -0,0 +1,39 @@
+/*	File:	swtimer.h
+*	Desc:	This is the include file for the software
+*			timer routines in swtimer.c for the
+*			AutoMotion project.
+*	Proj:	AutoMotion
+*/
+
+#ifndef SWTIMER_H
+#define SWTIMER_H
+
+/* includes */
+#include "includes.h"
+
+/* defines */
+//Wheel tick is 2^SWTIMER_SHIFT ms
+#define SWTIMER_SHIFT		4
+//Slots per level, must be a power of 2
+#define SWTIMER_SLOTS		16
+#define SWTIMER_SLOT_SHIFT	4
+
+/* types */
+typedef void (*SWTIMER_FUNC)(void *arg);
+
+typedef struct SWTIMER_STRUCT{
+	struct SWTIMER_STRUCT	*Next;
+	struct SWTIMER_STRUCT	**Pprev;	//link that points at this timer, NULL if stopped
+	uint32_t				Expire;		//wheel tick it expires on
+	SWTIMER_FUNC			Func;		//called from swtimerService() on expiry
+	void					*Arg;
+}SWTIMER;
+
+/* prototypes */
+void	swtimerInit		(void);
+void	swtimerStart	(SWTIMER *timer, uint32_t ms, SWTIMER_FUNC func, void *arg);
+void	swtimerStop		(SWTIMER *timer);
+bool	swtimerRunning	(const SWTIMER *timer);
+void	swtimerService	(void);
+
+#endif /* #ifndef SWTIMER_H */
@@ -21,10 +21,43 @@
 #include "includes.h"
 
 /* Definitions */
+//Define PWM_HIRES to run TOC1 at F_OSC/1, 0.125 us per count, with an
+//	8 ms frame so TOP still fits in 16 bits.  For digital servos only,
+//	analog servos want the 20 ms frame.
+//#define PWM_HIRES
+#ifdef PWM_HIRES
+#define TOC1_CS			( 1<<CS10 )		//F_OSC/1
+#define TOC1_CNT_SHIFT	(3)				//8 counts per us
+#define TOC1_TOP_VAL	(63999)			//8 ms
+#else
+#define TOC1_CS			( 1<<CS11 )		//F_OSC/8
+#define TOC1_CNT_SHIFT	(0)				//1 count per us
 #define TOC1_TOP_VAL	(20000)
+#endif
+//Frame length, x 1 us
+#define TOC1_FRAME_US	((TOC1_TOP_VAL + 1)>>TOC1_CNT_SHIFT)
+//TOC1 counts in a time, x 1 us; unsigned, as the 5 ms frame is 40000
+//	counts with PWM_HIRES
+#define PWM_US(us)		((uint16_t)(us)<<TOC1_CNT_SHIFT)
 #define PWM_DTY_DFLT	(1500)
+//TOC2 runs free at F_OSC/1024, 128 us per count, and each tick is a
+//	number of counts on from the compare that ended the last one
+#define TOC2_CS			( 1<<CS22 | 1<<CS21 | 1<<CS20 )
+#define TOC2_CNT_US		(128)
+//Longest tick, under the 256 count wrap of TCNT2
+#define TICK_MAX_MS		(32)
+
+/* Globals */
+//32 bit ms counter, only the TOC2 ISR writes it.  Read it with
+//	timerGetMs() outside of interrupts.
+extern volatile uint32_t	MS_TIMER;
 
 /* Function Prototypes */
-void timerInit		(void);
+void 		timerInit	(void);
+uint32_t	timerGetMs	(void);
+uint32_t	timerGetUs	(void);
+uint8_t		timerTickElapsed(void);
+void		timerSetNextTick(uint16_t ms);
+void		timerAddHalt(uint16_t us);
 
 #endif /* #ifndef TIMER_H */
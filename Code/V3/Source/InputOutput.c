@@ -2,17 +2,45 @@
 
 #include "includes.h"
 
+//Servo output state asked for with SetPWMOutput(), bit 0 for channel 0
+static volatile uint8_t		PwmOutReq;
+//TOP asked for with SetPWMPeriod(), 0 when none
+static volatile uint16_t	PwmPeriodReq;
+
+#if PWM_CH_NUM > 2
+//Software channel pins
+static const uint8_t		PwmSwPin[2] = { 1<<PD6, 1<<PD7 };
+//Software channel pulse widths, TOC1 counts, latched at frame start
+static volatile uint16_t	PwmSwDuty[PWM_SW_NUM];
+//This frame's pulse ends in TOC1 counts, in order, with the pins that
+//	go low at each
+static uint16_t				PwmSwEnd[PWM_SW_NUM];
+static uint8_t				PwmSwMask[PWM_SW_NUM];
+static uint8_t				PwmSwEdges;
+static uint8_t				PwmSwNext;
+#endif
+
 void IOInit(void){
 
+	//Local variables
+	uint8_t		ch;
+
 	/* Init HW  Systems*/	
 	timerInit();
 	a2dInit();
 	
-	//Turn on PWM Pin
-	PWM_ON;
+#if PWM_CH_NUM > 2
+	//Software PWM pins low, edges are timed with TOC0 overflows
+	PORTD	&= ~PWM_SW_PINS;
+	TIMSK	|= ( 1<<TOIE0 );
+#endif
 	
-	//Set servo to mid position
-	SetPWMDuty(PWM_CENTER_DFLT);
+	//Turn on PWM Pins at the first compare match, servos to mid position
+	for( ch = 0; ch < PWM_CH_NUM; ch++ ){
+		SetPWMOutput(ch, TRUE);
+		SetPWMDuty(ch, PWM_US(PWM_CENTER_DFLT));
+	}//end for
+	motionInit(PWM_CENTER_DFLT);
 	
 	//Turn on pull up for MODE pin PB0
 	//added 10/14/05, Scott Nortman
@@ -25,22 +53,191 @@ void IOInit(void){
 	//Pull up for NORM or /REV pin (PD0)
 	PORTD |= (1<<PD0);
 	
+	//Turn on interrupts, the a2d scan runs from its ISR
+	INTR_ON;
+	
 }//end IOInit
 
-void SetPWMDuty(uint16_t highTime){
+void SetPWMDuty(uint8_t ch, uint16_t highTime){
 
+	//Local variables
+	uint8_t		sreg;
+	
+	//OCR1A/B are double buffered in mode 14, the new duty starts
+	//	with the next frame and never cuts a pulse short.  The 16 bit
+	//	write shares TEMP with the ISRs.  Software channels latch theirs
+	//	at the start of the frame the same way.
+	sreg	= SREG;
+	INTR_OFF;
+	if( ch == 0 ){
 		OCR1AH = highTime>>8;
 		OCR1AL = highTime&0x00FF;
+	}//end if
+#if PWM_CH_NUM > 1
+	else if( ch == 1 ){
+		OCR1BH = highTime>>8;
+		OCR1BL = highTime&0x00FF;
+	}//end else if
+#endif
+#if PWM_CH_NUM > 2
+	else
+		PwmSwDuty[ch - 2] = highTime;
+#endif
+	SREG	= sreg;
 
 } /* end timerSetPWMDuty */
 
+void SetPWMOutput(uint8_t ch, bool on){
+
+	//Local variables
+	uint8_t		sreg;
+	
+	//The pin is switched by the channel's next compare match, right
+	//	after the pulse ends, so a pulse is never started or ended
+	//	early.  Software channels are switched at the next frame start.
+	sreg		= SREG;
+	INTR_OFF;
+	if( on )
+		PwmOutReq |= (1<<ch);
+	else
+		PwmOutReq &= ~(1<<ch);
+	if( ch == 0 ){
+		TIFR	= (1<<OCF1A);
+		TIMSK	|= (1<<OCIE1A);
+	}//end if
+#if PWM_CH_NUM > 1
+	else if( ch == 1 ){
+		TIFR	= (1<<OCF1B);
+		TIMSK	|= (1<<OCIE1B);
+	}//end else if
+#endif
+	SREG		= sreg;
+
+} /* end SetPWMOutput */
+
+bool GetPWMOutput(uint8_t ch){
+
+	//Requested state, the pin follows within one frame
+	return ( PwmOutReq & (1<<ch) ) != 0;
+
+} /* end GetPWMOutput */
+
+uint16_t GetPWMHighMax(void){
+
+	//Local variables
+	uint16_t	high = 0;
+	
+	//Latest pulse end this frame among the pins driven, TOC1 counts,
+	//	0 if all are tri-stated.  Interrupts must be off, the 16 bit
+	//	reads share TEMP.
+	if( DDRB & (1<<PB1) )
+		high = OCR1A;
+#if PWM_CH_NUM > 1
+	if( (DDRB & (1<<PB2)) && OCR1B > high )
+		high = OCR1B;
+#endif
+#if PWM_CH_NUM > 2
+	if( PwmSwEdges && PwmSwEnd[PwmSwEdges - 1] > high )
+		high = PwmSwEnd[PwmSwEdges - 1];
+#endif
+	
+	return high;
+
+} /* end GetPWMHighMax */
+
+void PWMFrameStart(void){
+
+#if PWM_CH_NUM > 2
+	//Local variables
+	uint16_t	start;
+	uint16_t	end;
+	uint8_t		on = 0;
+	uint8_t		i;
+	uint8_t		j;
+	
+	//Switch the pins asked for, then start their pulses together.
+	//	A pin is only driven while on and is low whenever DDRD changes,
+	//	so the pull-up is never turned on.
+	for( i = 0; i < PWM_SW_NUM; i++ )
+		if( PwmOutReq & (1<<(i + 2)) )
+			on |= PwmSwPin[i];
+	DDRD	= ( DDRD & ~PWM_SW_PINS ) | on;
+	PORTD	|= on;
+	PwmSwEdges = 0;
+	if( !on )
+		return;
+	start	= TCNT1;
+	
+	//Sort the pulse ends once, pins ending together share an edge.
+	//	Each channel costs one pass over the edges before it.
+	for( i = 0; i < PWM_SW_NUM; i++ ){
+	
+		if( !(on & PwmSwPin[i]) )
+			continue;
+		
+		end = start + PwmSwDuty[i];
+		for( j = 0; j < PwmSwEdges && PwmSwEnd[j] != end; j++ );
+		if( j < PwmSwEdges ){
+			PwmSwMask[j] |= PwmSwPin[i];
+			continue;
+		}//end if
+		
+		for( j = PwmSwEdges; j && PwmSwEnd[j - 1] > end; j-- ){
+			PwmSwEnd[j]		= PwmSwEnd[j - 1];
+			PwmSwMask[j]	= PwmSwMask[j - 1];
+		}//end for
+		PwmSwEnd[j]		= end;
+		PwmSwMask[j]	= PwmSwPin[i];
+		PwmSwEdges++;
+	
+	}//end for
+	
+	//First wake up in 256 us, before the shortest pulse can end
+	PwmSwNext	= 0;
+	TCNT0		= 0;
+	TIFR		= (1<<TOV0);
+	TCCR0		= (1<<CS01);
+#endif
+
+} /* end PWMFrameStart */
+
 void SetPWMPeriod(uint16_t period){
 
-	ICR1H = period>>8;
-	ICR1L = period&0x00FF;
+	//Local variables
+	uint8_t		sreg;
+	
+	//ICR1 isn't double buffered, a TOP below TCNT1 would miss and run
+	//	the counter to 0xFFFF.  It is written by the next OC1A compare
+	//	match, when TCNT1 is the pulse width, below any frame length.
+	sreg			= SREG;
+	INTR_OFF;
+	PwmPeriodReq	= period;
+	TIFR			= (1<<OCF1A);
+	TIMSK			|= (1<<OCIE1A);
+	SREG			= sreg;
 
 } /* end timerPWMPeriod */
 
+uint16_t SetPWMFrame(SERVO_FRAME frame){
+
+	//Local variables
+	uint16_t	top;
+	
+	//TOP for the frame rate, in TOC1 counts
+	if		( frame == SERVO_FRAME_200HZ )
+		top = PWM_US(PWM_FRAME_200HZ) - 1;
+	else if( frame == SERVO_FRAME_333HZ )
+		top = PWM_US(PWM_FRAME_333HZ) - 1;
+	else
+		top = TOC1_TOP_VAL;
+	
+	SetPWMPeriod(top);
+	
+	//Frame length, x 1 us
+	return ((uint32_t)top + 1)>>TOC1_CNT_SHIFT;
+
+} /* end SetPWMFrame */
+
 KEY_POS		GetKeyPos	(void){
 
 	if( PINC & (1<<PC0) )
@@ -50,15 +247,7 @@ KEY_POS		GetKeyPos	(void){
 
 }//end GetKeyPos
 
-SWITCH_POS	GetSwitchPos(void){
-
-	//Local Variables
-	uint16_t temp;
-	
-	//Sampl A2D
-	INTR_OFF;
-	temp = a2dSample(A2D_SWITCH_CH);
-	INTR_ON;
+static SWITCH_POS SwitchDecode(uint16_t temp){
 
 	//Define switch value based on A2D count
 	if		 ( temp < DOWN_MAX_COUNT ){
@@ -71,8 +260,22 @@ SWITCH_POS	GetSwitchPos(void){
 		return UP;
 	}//end else
 
+}//end SwitchDecode
+
+SWITCH_POS	GetSwitchPos(void){
+
+	//Latest sample from the a2d scan
+	return SwitchDecode(a2dGetSample(A2D_SWITCH_CH));
+
 }//end GetSwitchPos
 
+SWITCH_POS	GetSwitchPosTime(uint32_t *us){
+
+	//Latest sample from the a2d scan and the us time it was taken
+	return SwitchDecode(a2dGetSampleTime(A2D_SWITCH_CH, us));
+
+}//end GetSwitchPosTime
+
 DIR_PIN		GetDirPin  	(void){
 
 	if( PIND & (1<<PD0) )
@@ -81,3 +284,94 @@ DIR_PIN		GetDirPin  	(void){
 		return REV;
 
 }//end GetDirPin
+
+//Interrupt service routine for TOC1 compare match A
+SIGNAL(SIG_OUTPUT_COMPARE1A){
+/*	Desc:		Switches the servo pin as asked for by SetPWMOutput(),
+*				and sets the frame TOP asked for by SetPWMPeriod().
+*				Runs right after the pulse ends, so the pin is low.
+*	Args:		None.
+*	Ret:		None.
+*	Side E:		Disables itself; one shot per request.
+*/
+
+	if( PwmOutReq & (1<<0) )
+		PWM_ON;
+	else
+		PWM_OFF;
+	
+	if( PwmPeriodReq ){
+		ICR1H			= PwmPeriodReq>>8;
+		ICR1L			= PwmPeriodReq&0x00FF;
+		PwmPeriodReq	= 0;
+	}//end if
+	
+	TIMSK &= ~(1<<OCIE1A);
+
+}//end SIG_OUTPUT_COMPARE1A
+
+#if PWM_CH_NUM > 1
+//Interrupt service routine for TOC1 compare match B
+SIGNAL(SIG_OUTPUT_COMPARE1B){
+/*	Desc:		Switches the channel 1 pin as asked for by
+*				SetPWMOutput(), right after its pulse ends.
+*	Args:		None.
+*	Ret:		None.
+*	Side E:		Disables itself; one shot per request.
+*/
+
+	if( PwmOutReq & (1<<1) )
+		PWM_B_ON;
+	else
+		PWM_B_OFF;
+	
+	TIMSK &= ~(1<<OCIE1B);
+
+}//end SIG_OUTPUT_COMPARE1B
+#endif
+
+#if PWM_CH_NUM > 2
+//Interrupt service routine for TOC0 overflow
+SIGNAL(SIG_OVERFLOW0){
+/*	Desc:		Ends the software channel pulses in order.  TOC0
+*				counts us off the prescaler TOC1 uses, and is
+*				reloaded to overflow PWM_SW_LEAD before the next
+*				end to the us, at most 250 us at a time.  Only the
+*				ISR entry is left to wait out on TCNT1, so the wait
+*				with interrupts off is at most PWM_SW_LEAD and the
+*				last us count.  The pulse end is only on time for a
+*				wake no other ISR held up.  One that was waits for
+*				nothing, and ends its pulse late by about as long as
+*				it was held, 62 us in isrbench after a 60 us ISR.
+*	Args:		None.
+*	Ret:		None.
+*	Side E:		TOC0 is stopped after the last edge of the frame.
+*/
+
+	//Local variables
+	int16_t		wait;
+	
+	for( ;; ){
+	
+		wait = PwmSwEnd[PwmSwNext] - TCNT1;
+		
+		if( wait >= PWM_SW_LEAD + PWM_US(1) ){
+			wait = (wait - PWM_SW_LEAD)>>TOC1_CNT_SHIFT;
+			if( wait > 250 )
+				wait = 250;
+			TCNT0 = 256 - wait;
+			return;
+		}//end if
+		
+		while( (int16_t)(PwmSwEnd[PwmSwNext] - TCNT1) > 0 );
+		PORTD &= ~PwmSwMask[PwmSwNext];
+		
+		if( ++PwmSwNext == PwmSwEdges ){
+			TCCR0 = 0;
+			return;
+		}//end if
+	
+	}//end for
+
+}//end SIG_OVERFLOW0
+#endif
@@ -15,31 +15,582 @@
 *	Date		Who				What
 *--------------------------------------------------
 *	11/3/2004	S. Nortman		Initiated File
+*
+*	NOTES:
+*
+*		Every channel in the scan has its own sample period in ms, set
+*	with a2dSetPeriod().  a2dTick() runs from the TOC2 tick; when a
+*	channel's period runs out it is marked active, and the tick starts a
+*	conversion of an active channel if the a2d is idle.  a2dTick() returns
+*	the time to the next period that runs out, so the tick can be made as
+*	long as the a2d allows.  The atmega8 has
+*	no auto trigger source, so this is the cheapest way to pace the a2d.
+*	The conversion complete interrupt puts the next active channel on the
+*	mux before it stores the result, so the new channel settles while the
+*	result is handled and for the rest of the tick.  A channel with a
+*	period of 0 is never converted.
+*
+*		Each channel has a profile that is set with the mux.  The switch
+*	only needs to tell three voltage bands apart, so it uses the fast
+*	profile: F_OSC/16 a2d clock and left adjusted 8 bit results read from
+*	ADCH alone, 26 us per conversion.  The pots use the precise profile,
+*	F_OSC/64 and 10 bits, 104 us per conversion.
+*
+*		If the tick or a2dSleepService() has to change the mux right before
+*	a conversion, the input has not settled.  Channels with Discard set in
+*	A2dScan throw that first conversion away and convert again right
+*	away; the others keep it.  The switch discards too: after a sleep
+*	conversion the tick always switches the mux to it, so an unsettled
+*	first conversion would be off the same way every period and the
+*	debounce would not catch it.
+*
+*		Channels in A2D_MODE_OVERSAMPLE take A2D_OVERSAMPLE conversions
+*	back to back, restarted from the conversion complete interrupt since
+*	the mux doesn't change, and shift the sum down by A2D_DECIMATE_SHIFT,
+*	giving one 12 bit result per period.  Channels in A2D_MODE_RAW publish a single
+*	conversion per period, scaled up to 12 bits so all results share one
+*	scale.
+*
+*		Channels in A2D_MODE_SLEEP are never started by the tick.  When
+*	their period runs out they are converted from the main loop by
+*	a2dSleepService(), with the CPU in ADC noise reduction sleep.  This
+*	halts clkIO, so TOC1 stops while the conversion runs; the conversion is
+*	only started while the servo pins are low and far enough from the next
+*	pulse that the pulse width is not changed.  The frame and the TOC2
+*	tick are stretched by the ~104 us conversion time, which
+*	a2dSleepService() hands back to the time base with timerAddHalt().
+*	Each sleep is started from the main loop, a discard too, so every
+*	sleep is one whole conversion of a known length.
+*
+*		Results go into a small ring per channel.  The ISR writes the slot
+*	after the head and then moves the head, so the newest result is never
+*	being written.  Readers use the per channel result count to detect a
+*	new result during their read and retry, so interrupts are never
+*	disabled to get a sample.  The newest result of each channel also
+*	keeps the timerGetUs() time it was published.
 */
 
 #include "includes.h"
 
+//Starts a conversion without clearing a pending conversion complete flag
+#define A2D_START			(ADCSRA = (ADCSRA & ~(1<<ADIF)) | (1<<ADSC))
+
+//Setup of one channel in the scan
+typedef struct{
+	uint8_t		Ch;			//mux channel
+	A2D_MODE	Mode;
+	A2D_PROFILE	Profile;
+	bool		Discard;	//drop the first conversion after an unsettled mux change
+	uint16_t	Period;		//default sample period, x 1 ms
+}A2D_SLOT_CFG;
+
+//The scan
+static const A2D_SLOT_CFG	A2dScan[A2D_SCAN_NUM] = {
+	{ A2D_SWITCH_CH,	A2D_MODE_RAW,		A2D_PROFILE_FAST,		TRUE,	A2D_SWITCH_PERIOD	},
+	{ A2D_SPEED_CH,		A2D_MODE_OVERSAMPLE,A2D_PROFILE_PRECISE,	TRUE,	A2D_POT_PERIOD		},
+	{ A2D_OPEN_CH,		A2D_MODE_SLEEP,		A2D_PROFILE_PRECISE,	TRUE,	A2D_POT_PERIOD		},
+	{ A2D_CLSD_CH,		A2D_MODE_SLEEP,		A2D_PROFILE_PRECISE,	TRUE,	A2D_POT_PERIOD		}
+};
+//Maps a mux channel to its slot in the scan list
+static uint8_t				A2dChSlot[A2D_MUX_NUM];
+//Sample period and countdown, indexed by scan slot
+static uint16_t				A2dPeriod[A2D_SCAN_NUM];
+static uint16_t				A2dCountdown[A2D_SCAN_NUM];
+//Oversampling accumulators, indexed by scan slot
+static uint16_t				A2dAcc[A2D_SCAN_NUM];
+static uint8_t				A2dAccCount[A2D_SCAN_NUM];
+//Decimated results, indexed by scan slot
+static volatile uint16_t	A2dRing[A2D_SCAN_NUM][A2D_RING_SIZE];
+static volatile uint8_t		A2dHead[A2D_SCAN_NUM];
+//Incremented every time a result is published
+static volatile uint8_t		A2dCount[A2D_SCAN_NUM];
+//us time the newest result was published
+static volatile uint32_t	A2dTimeUs[A2D_SCAN_NUM];
+//Slot on the mux
+static volatile uint8_t		A2dSlot;
+//Tick slots waiting for conversions, one bit per slot
+static volatile uint8_t		A2dActive;
+//Sleep mode slots waiting for a conversion, one bit per slot
+static volatile uint8_t		A2dSleepMask;
+//Set while a2dSleepService() owns the a2d
+static volatile bool		A2dSleepBusy;
+//Cleared when the mux was changed right before a conversion
+static volatile bool		A2dSettled;
+
+static void a2dSelect(uint8_t slot){
+/*	Desc:		Selects the mux channel and profile for the next
+*				conversion.
+*	Args:		slot, scan slot.
+*	Ret:		None.
+*	PreReq:		No conversion may be running.
+*/
+
+	//Local variables
+	const A2D_SLOT_CFG	*cfg = &A2dScan[slot];
+	
+	if( cfg->Profile == A2D_PROFILE_FAST ){
+	
+		ADMUX	= (ADMUX & ~(0x07 | 1<<ADLAR)) | (1<<ADLAR) | (cfg->Ch & 0x07);
+		ADCSRA	= (ADCSRA & ~(1<<ADIF | 0x07)) | A2D_FAST_PS;
+	
+	}//end if
+	else{
+	
+		ADMUX	= (ADMUX & ~(0x07 | 1<<ADLAR)) | (cfg->Ch & 0x07);
+		ADCSRA	= (ADCSRA & ~(1<<ADIF | 0x07)) | A2D_PRECISE_PS;
+	
+	}//end else
+
+}//end a2dSelect
+
+static uint16_t a2dRead(uint8_t slot){
+/*	Desc:		Reads a finished conversion.
+*	Args:		slot, scan slot that was converted.
+*	Ret:		Result scaled to 10 bits.
+*	Notes:		Fast profile results are left adjusted, so only ADCH is
+*				read.  Otherwise ADCL must be read before ADCH.
+*/
+
+	//Local variables
+	uint16_t	temp;
+	
+	if( A2dScan[slot].Profile == A2D_PROFILE_FAST ){
+	
+		temp = (uint16_t)ADCH<<2;
+	
+	}//end if
+	else{
+	
+		temp  = ADCL;
+		temp |= (uint16_t)ADCH<<8;
+	
+	}//end else
+	
+	return temp;
+
+}//end a2dRead
+
+static bool a2dSelectActive(uint8_t slot){
+/*	Desc:		Puts the next active tick slot after slot on the mux.
+*	Args:		slot, slot to search from.
+*	Ret:		TRUE if an active slot was found.
+*	Notes:		Round robin, so one slot can't starve the others.
+*/
+
+	//Local variables
+	uint8_t		i;
+	
+	for( i = 0; i < A2D_SCAN_NUM; i++ ){
+	
+		if( ++slot >= A2D_SCAN_NUM )
+			slot = 0;
+		
+		if( A2dActive & (1<<slot) ){
+		
+			A2dSlot = slot;
+			a2dSelect(slot);
+			return TRUE;
+		
+		}//end if
+	
+	}//end for
+	
+	return FALSE;
+
+}//end a2dSelectActive
+
+static bool a2dQuietWindow(void){
+/*	Desc:		Checks that the servo pins are low and will stay low
+*				for longer than a sleep conversion.
+*	Args:		None.
+*	Ret:		TRUE if a sleep conversion may start now.
+*	PreReq:		Interrupts must be off, TOC1 16 bit reads share TEMP.
+*/
+
+	//Local variables
+	uint16_t	count;
+	uint16_t	high;
+
+	//Pins are tri-stated, nothing to protect
+	high = GetPWMHighMax();
+	if( !high )
+		return TRUE;
+	
+	count = TCNT1;
+	
+	return (	( count > high )
+			&&	( count < ICR1 - A2D_SLEEP_GUARD ) );
+
+}//end a2dQuietWindow
+
 void a2dInit(void){
+/*	Desc:		Turns the a2d on, fills every result ring with a
+*				blocking conversion and then hands the a2d to the tick.
+*	Args:		None.
+*	Ret:		None.
+*	PreReq:		Must be called with interrupts off.
+*	Notes:		This is the only place the a2d is polled.
+*/
+
+	//Local variables
+	uint8_t		slot;
+	uint8_t		i;
+	uint16_t	temp;
+
+	//Build channel to slot map
+	for( slot = 0; slot < A2D_MUX_NUM; slot++ )
+		A2dChSlot[slot] = A2D_NO_SLOT;
+	for( slot = 0; slot < A2D_SCAN_NUM; slot++ )
+		A2dChSlot[A2dScan[slot].Ch & 0x07] = slot;
 
 	/* Set to internal vref = 2.56 v, cap on vref */
 	
-	/* Turn a2d on, disable int. */
-	ADCSRA |= (1<<ADEN | 1<<ADPS2 | 1<<ADPS1);
+	/* Turn a2d on */
+	ADCSRA |= (1<<ADEN);
+
+	//Prime the rings so readers never see an empty result
+	for( slot = 0; slot < A2D_SCAN_NUM; slot++ ){
+
+		a2dSelect(slot);
+		ADCSRA |= (1<<ADSC);
+		while( (ADCSRA & (1<<ADSC)) );
+
+		temp = a2dRead(slot);
+		for( i = 0; i < A2D_RING_SIZE; i++ )
+			A2dRing[slot][i] = temp<<A2D_DECIMATE_SHIFT;
+		
+		//Default period, first one runs out on the first tick
+		A2dPeriod[slot]		= A2dScan[slot].Period;
+		A2dCountdown[slot]	= 1;
+
+	}//end for
+
+	A2dSlot		= 0;
+	A2dSettled	= TRUE;
+	a2dSelect(0);
+	ADCSRA |= (1<<ADIF | 1<<ADIE);
 
 } /* end a2dInit */
 
-uint16_t a2dSample(uint8_t channel){
+uint16_t a2dGetOlder(uint8_t channel, uint8_t age){
+/*	Desc:		Returns a result from the channel's ring.
+*	Args:		channel, mux channel that is part of the scan list.
+*				age, 0 for the newest result, up to A2D_RING_SIZE - 2.
+*	Ret:		12 bit a2d count.
+*	Notes:		Does not disable interrupts; the read is retried if a
+*				result was published while it was in progress.  The
+*				oldest ring entry is the one being written, so it is
+*				never returned.
+*/
+
+	//Local variables
+	uint8_t		slot;
+	uint8_t		count;
+	uint16_t	temp;
+	
+	slot = A2dChSlot[channel & 0x07];
+	
+	do{
+		count	= A2dCount[slot];
+		temp	= A2dRing[slot][(A2dHead[slot] - age) & (A2D_RING_SIZE - 1)];
+	}while( count != A2dCount[slot] );
+	
+	return temp;
+
+} /* end a2dGetOlder */
+
+uint16_t a2dGetSample(uint8_t channel){
+/*	Desc:		Returns the newest result for a channel.
+*	Args:		channel, mux channel that is part of the scan list.
+*	Ret:		12 bit a2d count.
+*/
+
+	return a2dGetOlder(channel, 0);
 
-	/* set channel */
-	ADMUX = ((ADMUX & ~0x07) | (channel & 0x07));
+} /* end a2dGetSample */
+
+uint16_t a2dGetSampleTime(uint8_t channel, uint32_t *us){
+/*	Desc:		Returns the newest result for a channel and the time
+*				its conversion finished.
+*	Args:		channel, mux channel that is part of the scan list.
+*				us, gets the timerGetUs() time of the result.
+*	Ret:		12 bit a2d count.
+*	Notes:		The time is taken in the conversion complete ISR, so it
+*				is within a conversion time of the input being sampled.
+*/
+
+	//Local variables
+	uint8_t		slot;
+	uint8_t		count;
+	uint16_t	temp;
+	
+	slot = A2dChSlot[channel & 0x07];
+	
+	do{
+		count	= A2dCount[slot];
+		temp	= A2dRing[slot][A2dHead[slot]];
+		*us		= A2dTimeUs[slot];
+	}while( count != A2dCount[slot] );
+	
+	return temp;
+
+} /* end a2dGetSampleTime */
+
+uint8_t a2dGetCount(uint8_t channel){
+/*	Desc:		Returns the number of results published for a channel.
+*	Args:		channel, mux channel that is part of the scan list.
+*	Ret:		Result count, wraps at 256.
+*	Notes:		Compare with an earlier count to see if there is a
+*				new result.
+*/
+
+	return A2dCount[A2dChSlot[channel & 0x07]];
+
+} /* end a2dGetCount */
+
+void a2dSetPeriod(uint8_t channel, uint16_t period){
+/*	Desc:		Sets the sample period of a channel.
+*	Args:		channel, mux channel that is part of the scan list.
+*				period, ms between results, 0 to stop.
+*	Ret:		None.
+*	Notes:		A shorter period takes effect at the next tick.
+*/
+
+	//Local variables
+	uint8_t		slot;
 	
-	/* trigger conversion */
-	ADCSRA |= (1<<ADSC);
+	slot = A2dChSlot[channel & 0x07];
 	
-	/* wait for conversion */
-	while( (ADCSRA & (1<<ADSC)) );
+	INTR_OFF;
 	
-	return ((uint16_t)(ADCL | ADCH<<8));
+	A2dPeriod[slot] = period;
+	if( !A2dCountdown[slot] || A2dCountdown[slot] > period )
+		A2dCountdown[slot] = period;
+	
+	INTR_ON;
+
+} /* end a2dSetPeriod */
 
-} /* end trigger conversion */
+uint16_t a2dTick(uint8_t elapsed){
+/*	Desc:		Runs the channel periods and starts a conversion of
+*				an active channel if the a2d is idle.
+*	Args:		elapsed, ms since the last call.
+*	Ret:		ms until the a2d needs the next call.
+*	PreReq:		Must be called from the TOC2 interrupt.
+*	Side E:		None.
+*	Notes:		Leaves the a2d alone while a2dSleepService() owns it.
+*				The tick is never longer than the returned time, so
+*				elapsed never passes a countdown.
+*/
+
+	//Local variables
+	uint8_t		slot;
+	uint16_t	next = 0xFFFF;
+	
+	for( slot = 0; slot < A2D_SCAN_NUM; slot++ ){
+	
+		if( !A2dCountdown[slot] )
+			continue;
+		
+		if( A2dCountdown[slot] <= elapsed ){
+		
+			//Period ran out, restart it and ask for a result
+			A2dCountdown[slot] = A2dPeriod[slot];
+			
+			if( A2dScan[slot].Mode == A2D_MODE_SLEEP )
+				A2dSleepMask |= (1<<slot);
+			else
+				A2dActive |= (1<<slot);
+		
+		}//end if
+		else{
+		
+			A2dCountdown[slot] -= elapsed;
+		
+		}//end else
+		
+		if( A2dCountdown[slot] && A2dCountdown[slot] < next )
+			next = A2dCountdown[slot];
+	
+	}//end for
+	
+	//Busy, or a result the ISR hasn't stored yet
+	if( A2dSleepBusy || (ADCSRA & (1<<ADSC | 1<<ADIF)) ){
+	
+		//Try again next ms if something is waiting
+		return ( A2dActive ? 1 : next );
+	
+	}//end if
+	
+	//Start the channel on the mux
+	if( A2dActive & (1<<A2dSlot) ){
+	
+		A2D_START;
+	
+	}//end if
+	//Or switch to one that is active, it gets no time to settle
+	else if( a2dSelectActive(A2dSlot) ){
+	
+		A2dSettled = FALSE;
+		A2D_START;
+	
+	}//end else if
+	
+	//More than one active, check back next ms
+	if( A2dActive & ~(1<<A2dSlot) )
+		return 1;
+	
+	return next;
+
+} /* end a2dTick */
+
+void a2dSleepService(void){
+/*	Desc:		Converts the waiting A2D_MODE_SLEEP channels with the
+*				CPU in ADC noise reduction sleep.
+*	Args:		None.
+*	Ret:		None.
+*	PreReq:		Must be called from the main loop with interrupts on.
+*	Side E:		CPU sleeps for each conversion, TOC1 and TOC2 are halted
+*				and the time is added back to the time base.
+*	Notes:		Converts one channel after another while the servo pins
+*				stay in a quiet part of the frame, so the lower slots
+*				can't take every window.  Returns without converting if
+*				a tick conversion is running or the pins are not quiet;
+*				call again on the next pass.
+*/
+
+	//Local variables
+	uint8_t		slot;
+	
+	if( !A2dSleepMask )
+		return;
+	
+	INTR_OFF;
+	
+	while(		A2dSleepMask
+			&&	!(ADCSRA & (1<<ADSC | 1<<ADIF))
+			&&	a2dQuietWindow() ){
+	
+		for( slot = 0; !(A2dSleepMask & (1<<slot)); slot++ );
+		
+		//Put the sleep channel on the mux, the ISR releases the a2d
+		A2dSlot			= slot;
+		A2dSleepBusy	= TRUE;
+		A2dSettled		= FALSE;
+		A2dSleepMask	&= ~(1<<slot);
+		a2dSelect(slot);
+		
+		//Entering noise reduction sleep starts the conversion.  The
+		//	instruction after sei() runs before any interrupt, so none
+		//	can start between them and the sleep.
+		set_sleep_mode(SLEEP_MODE_ADC);
+		do{
+		
+			sleep_enable();
+			INTR_ON;
+			sleep_cpu();
+			sleep_disable();
+			INTR_OFF;
+			
+			//Put back the time TOC1 and TOC2 lost
+			timerAddHalt(	( A2dScan[slot].Profile == A2D_PROFILE_FAST ) ?
+							A2D_FAST_HALT : A2D_PRECISE_HALT );
+		
+		}while( A2dSleepBusy );
+	
+	}//end while
+	
+	INTR_ON;
+
+}//end a2dSleepService
+
+//Interrupt service routine for a2d conversion complete
+SIGNAL(SIG_ADC){
+/*	Desc:		Reads the finished conversion, puts the next active slot
+*				on the mux, then accumulates the conversion and publishes
+*				a result when one is complete.
+*	Args:		None.
+*	Ret:		None.
+*	Globals:	A2dRing, A2dHead, A2dCount
+*	PreReq:		a2dInit() must have been called.
+*	Side E:		Mux is changed; the next conversion is started by the
+*				tick, except for discards and oversampling bursts.
+*				Also wakes the CPU from a2dSleepService().
+*	Notes:		ADLAR changes the result registers right away, so the
+*				result must be read before the next slot is selected.
+*/
+
+	//Local variables
+	uint16_t	temp;
+	uint8_t		slot;
+	uint8_t		head;
+	bool		publish;
+	
+	slot	= A2dSlot;
+	publish	= TRUE;
+	
+	//First conversion after an unsettled mux change, do it again.  A
+	//	sleep conversion is started again by the next sleep.
+	if( !A2dSettled && A2dScan[slot].Discard ){
+	
+		A2dSettled = TRUE;
+		if( !A2dSleepBusy )
+			A2D_START;
+		return;
+	
+	}//end if
+	A2dSettled = TRUE;
+	
+	//Read before the next slot's profile changes ADLAR
+	temp = a2dRead(slot);
+	
+	//Oversampling bursts keep the mux, anything else gets the next active
+	//	channel now so it settles while this result is stored
+	if(		( A2dScan[slot].Mode != A2D_MODE_OVERSAMPLE )
+		||	( A2dAccCount[slot] == A2D_OVERSAMPLE - 1 ) ){
+	
+		A2dActive &= ~(1<<slot);
+		a2dSelectActive(slot);
+	
+	}//end if
+	
+	if( A2dScan[slot].Mode == A2D_MODE_OVERSAMPLE ){
+	
+		A2dAcc[slot] += temp;
+		
+		if( ++A2dAccCount[slot] < A2D_OVERSAMPLE ){
+		
+			//Result not complete yet, next conversion back to back
+			publish = FALSE;
+			A2D_START;
+		
+		}//end if
+		else{
+		
+			//Decimate
+			temp				= A2dAcc[slot]>>A2D_DECIMATE_SHIFT;
+			A2dAcc[slot]		= 0;
+			A2dAccCount[slot]	= 0;
+		
+		}//end else
+	
+	}//end if OVERSAMPLE
+	else{
+	
+		temp <<= A2D_DECIMATE_SHIFT;
+	
+	}//end else
+	
+	if( publish ){
+	
+		//Publish result
+		head				= (A2dHead[slot] + 1) & (A2D_RING_SIZE - 1);
+		A2dRing[slot][head]	= temp;
+		A2dTimeUs[slot]		= timerGetUs();
+		A2dHead[slot]		= head;
+		A2dCount[slot]++;
+		A2dSleepBusy		= FALSE;
+	
+	}//end if
 
+}//end SIG_ADC
@@ -0,0 +1,73 @@
+/*	File:	filter.c
+*	Desc:	This file contains a bank of single pole
+*			IIR filters with a deadband on the output,
+*			used for the potentiometer inputs.
+*	Proj:	AutoMotion
+*
+*	NOTES:
+*
+*		Each channel runs State += Alpha * (input - State), with State held
+*	with 8 fractional bits and Alpha in Q8.8.  Output only follows the
+*	filtered value once it has moved more than Deadband counts away, so
+*	a2d noise on a pot that is not being turned never reaches the servo
+*	parameters.  A 12 bit input shifted up by 8 fits easily in 32 bits.
+*/
+
+#include "includes.h"
+
+void filterInit(FILTER_CH *filter, uint16_t alpha, uint16_t deadband, uint16_t value){
+/*	Desc:		Sets up a filter channel and starts it settled at value.
+*	Args:		filter, channel to set up.
+*				alpha, Q8.8 coefficient; FILTER_ONE is no filtering.
+*				deadband, input counts the filtered value must move.
+*				value, starting input value.
+*	Ret:		None.
+*/
+
+	filter->State		= (uint32_t)value<<FILTER_SHIFT;
+	filter->Output		= value;
+	filter->Alpha		= alpha;
+	filter->Deadband	= deadband;
+
+}//end filterInit
+
+bool filterUpdate(FILTER_CH *filter, uint16_t sample){
+/*	Desc:		Runs one input sample through a filter channel.
+*	Args:		filter, channel to update.
+*				sample, new input.
+*	Ret:		TRUE if Output changed.
+*/
+
+	//Local variables
+	int32_t		diff;
+	uint16_t	value;
+
+	//Single pole IIR
+	diff			= (int32_t)((uint32_t)sample<<FILTER_SHIFT) - (int32_t)filter->State;
+	filter->State	+= (diff * (int32_t)filter->Alpha) >> FILTER_SHIFT;
+	
+	//Round to input counts
+	value = (filter->State + (1<<(FILTER_SHIFT-1))) >> FILTER_SHIFT;
+	
+	//Deadband
+	if(		( value > filter->Output + filter->Deadband )
+		||	( value + filter->Deadband < filter->Output ) ){
+	
+		filter->Output = value;
+		return TRUE;
+	
+	}//end if
+	
+	return FALSE;
+
+}//end filterUpdate
+
+uint16_t filterOutput(const FILTER_CH *filter){
+/*	Desc:		Returns the deadbanded output of a filter channel.
+*	Args:		filter, channel to read.
+*	Ret:		Output in input counts.
+*/
+
+	return filter->Output;
+
+}//end filterOutput
@@ -118,6 +118,8 @@
 *		The servo PWM signal is turned off after a small delay to prevent the servo from
 *		"humming" at the endpoints of travel.  This is implemented by setting the OC1A
 *		output pin to a high impedance input, effectively cutting off the PWM to the servo.
+*		To keep the cover from being blown off position, the PWM is then turned back on
+*		for HOLD_BURST frames every HOLD_PERIOD ms.
 *
 */
 
@@ -127,11 +129,10 @@
 //Defines for NORM or REVERSE rotation
 #define NORM		1 	//pulled up internally
 #define REV			0	//pulled to GND
-//Sample rate = SAMPLE_DIV * 1 ms
-#define SAMPLE_DIV			20
+//Switch and key sample rate = SAMPLE_DIV * 1 ms, the switch's a2d period
+#define SAMPLE_DIV			A2D_SWITCH_PERIOD
 //Number of elements in filter array
 #define	FILTER_SIZE			3
-#define HUM_TIMEOUT			3000	//3 sec. timeout
 #define ACC_TIMEOUT			500
 //Defines for edges
 #define	POSEDGE				1
@@ -144,9 +145,39 @@
 #define	DEMO_CNT_REQ		5
 //Timeout to enter / exit STATE_DEMO
 #define DEMO_TIMEOUT		5000	//~ 5 seconds
-#define	DEMO_CYCLE_TIME		10000
 #define DEMO_SPEED			40
-#define PWM_ADJ_RESOLUTION	10
+//Latch clearance move at the start of an open from the closed limit,
+//	x 1 us past the lower limit, 0 for covers without a latch
+#define LATCH_CLEAR			0
+#define LATCH_SPEED			15
+//Potentiometer filter bank
+#define PARAM_OPEN			0
+#define PARAM_CLSD			1
+#define PARAM_SPEED			2
+#define PARAM_NUM			3
+#define PARAM_ALPHA			64		//Q8.8, 1/4 per sample
+#define PARAM_LIM_DEADBAND	16		//a2d counts, ~3 PWM counts
+#define PARAM_SPEED_DEADBAND	48	//a2d counts, 3/4 of a speed step
+//Potentiometer sample periods, x 1 ms.  Starts fast after a change and
+//	doubles after every PARAM_QUIET_CNT results without one.
+#define PARAM_PERIOD_FAST	20
+#define PARAM_PERIOD_SLOW	640
+#define PARAM_QUIET_CNT		16
+//Position hold after the hum timeout: a burst of HOLD_BURST frames
+//	every HOLD_PERIOD ms, 0 to leave the servo unpowered
+#define HOLD_PERIOD			500
+#define HOLD_BURST			2
+//Motion channel of the side the other sides follow, every channel is
+//	one side of the cover
+#define SERVO_CH			0
+//Scheduler tasks, in priority order
+#define TASK_INPUT			0
+#define TASK_MOTION			1
+#define TASK_CONTROL		2
+#define TASK_WDT			3
+#define TASK_NUM			4
+//Watchdog reset period, x 1 ms
+#define WDT_PERIOD			100
 
 
 //State machine enumerations
@@ -161,584 +192,857 @@ typedef enum{
 
 //Ram Based
 static SERVO_PARAMS ServoParamsRam = {
-	PWM_OPEN_DFLT,
-	PWM_CLOSED_DFLT,
-	PWM_SPEED_DFLT
+	{ PWM_OPEN_DFLT },
+	{ PWM_CLOSED_DFLT },
+	PWM_SPEED_DFLT,
+	PWM_FRAME_DFLT
 };
 static SERVO_PARAMS *ServoParamsRamPtr = &ServoParamsRam;
+//Trims of each side, for the second and later servos
+static const SERVO_SIDE ServoSide[4] = {
+	{ 0, 0, FALSE },
+	{ 0, 0, FALSE },
+	{ 0, 0, FALSE },
+	{ 0, 0, FALSE }
+};
 
-//32 bit ms counter
-static volatile uint32_t	MS_TIMER;	
-//Flag indicating we ned to sample the pin
-static volatile bool		SampleFlag;
 //Vaiable to hold the current state
 static	STATE				CurrentState;
 //Holds servo position
-static uint16_t			DesiredDutyCycle;
-static volatile uint16_t	CurrentDutyCycle;
+//Filters for the potentiometers
+static FILTER_CH			ParamFilter[PARAM_NUM];
+//A2d channel of each filter
+static const uint8_t		ParamCh[PARAM_NUM] = {
+	A2D_OPEN_CH,
+	A2D_CLSD_CH,
+	A2D_SPEED_CH
+};
+//Last a2d result count seen for each filter
+static uint8_t				ParamCount[PARAM_NUM];
+//Current potentiometer sample period
+static uint16_t				ParamPeriod;
+//Results since the last change
+static uint8_t				ParamQuiet;
+//For switch input
+static SWITCH_POS			SwitchPosArray[FILTER_SIZE];
+static uint32_t				SwitchTimeArray[FILTER_SIZE];	//us time of each sample
+static SWITCH_POS			SwitchPosOld;
+static SWITCH_POS			SwitchPosNew;						//Holds value of switch position
+static SWITCH_EVENT_STRUCT	SwitchEventStruct;
+//For Key Input
+static KEY_POS				KeyPosArray[FILTER_SIZE];
+static uint32_t				KeyTimeArray[FILTER_SIZE];		//us time of each sample
+static KEY_POS				KeyPosOld;
+static KEY_POS				KeyPosNew;							//hold value of key position
+static KEY_EVENT_STRUCT	KeyEventStruct;
 
-//Main Routine
-int16_t main( void ){
-/*	Desc:		This is the main routine for the tCover servo control module.
-*	Args:		None.
-*	Ret:		int16_t, so compiler doesn't complain.
-*	Globals:	g_servoStateDesired
+//StateNormal variables
+//Set when ACC_TIMEOUT has passed since reboot
+static bool				StateNormalAccReady;
+//Sub-state variable indicating active edge
+static uint8_t			StateNormalEdge;
+//Variable to hold override switch transitions for lock mode
+static uint8_t			StateNormalLockCount;
+//Switch transitions for demo mode
+static uint8_t			StateNormalDemoCount;
+
+//STATE_LOCKED variables
+static bool				StateLockedInit;
+//Counts switch DOWN to CENTER edges
+static uint8_t			StateLockedEdgeCount;
+
+//STATE_DEMO variables
+static uint8_t			StateDemoEdgeCount;
+static bool				StateDemoCycleFlag;
+static bool				StateDemoInit;
+static uint16_t			StateDemoNormalSpeed;
+
+//For user implemented reset
+static uint32_t			UserReset;
+
+//Timeouts
+static SWTIMER				AccTimer;			//ACC ignored until it expires
+static SWTIMER				NormalLockTimer;	//STATE_LOCKED entry window
+static SWTIMER				NormalDemoTimer;	//STATE_DEMO entry window
+static SWTIMER				LockedTimer;		//STATE_LOCKED exit window
+static SWTIMER				DemoEdgeTimer;		//STATE_DEMO exit window
+
+static void ClearCount( void *arg ){
+/*	Desc:		Timer expiry function, clears an edge count.
+*	Args:		arg, points at the uint8_t count.
+*	Ret:		None.
+*	Globals:	None.
 *	PreReq:		None.
-*	Side E:		A2D inputs are sampled, PWM is generated.
+*	Side E:		None.
+*	Notes:		None.
+*/
+
+	*(uint8_t *)arg = 0;
+
+}//end ClearCount
+
+static void SetFlag( void *arg ){
+/*	Desc:		Timer expiry function, sets a flag.
+*	Args:		arg, points at the bool flag.
+*	Ret:		None.
+*	Globals:	None.
+*	PreReq:		None.
+*	Side E:		None.
 *	Notes:		None.
 */
+
+	*(bool *)arg = TRUE;
+
+}//end SetFlag
+
+static void SetServoParams( void ){
+/*	Desc:		Sets the servo parameters from the filtered potentiometers.
+*	Args:		None.
+*	Ret:		None.
+*	Globals:	ServoParamsRam, ParamFilter
+*	PreReq:		ParamFilter must be initialized.
+*	Side E:		None.
+*	Notes:		The a2d results are 12 bits; the scaling is the same
+*				as the old 10 bit 3*(x>>2) and x>>4, but the shift is
+*				done after the multiply so the extra bits are kept.
+*				Each side gets the limits plus its ServoSide trims.
+*/
+
+	//Local variables
+	uint16_t	upper;
+	uint16_t	lower;
+	int16_t		lim;
+	uint8_t		ch;
+	
+	upper	= PWM_OPEN_LIM - ((3*filterOutput(&ParamFilter[PARAM_OPEN]))>>4);
+	lower	= PWM_CLSD_LIM + ((3*filterOutput(&ParamFilter[PARAM_CLSD]))>>4);
+	
+	for( ch = 0; ch < PWM_CH_NUM; ch++ ){
+	
+		lim = upper + ServoSide[ch].UpperTrim;
+		if		( lim > PWM_OPEN_LIM )
+			lim = PWM_OPEN_LIM;
+		else if( lim < PWM_CLSD_LIM )
+			lim = PWM_CLSD_LIM;
+		ServoParamsRamPtr->UpperLimit[ch] = ServoSide[ch].Mirror ? 2*PWM_CENTER_DFLT - lim : lim;
+		
+		lim = lower + ServoSide[ch].LowerTrim;
+		if		( lim > PWM_OPEN_LIM )
+			lim = PWM_OPEN_LIM;
+		else if( lim < PWM_CLSD_LIM )
+			lim = PWM_CLSD_LIM;
+		ServoParamsRamPtr->LowerLimit[ch] = ServoSide[ch].Mirror ? 2*PWM_CENTER_DFLT - lim : lim;
+	
+	}//end for
+	
+	ServoParamsRamPtr->Speed		= filterOutput(&ParamFilter[PARAM_SPEED])>>6;
 	
+	motionSetSpeed(ServoParamsRamPtr->Speed);
+
+}//end SetServoParams
+
+static void OpenCover( void ){
+/*	Desc:		Moves the servos to the upper limits.
+*	Args:		None.
+*	Ret:		None.
+*	Globals:	ServoParamsRam
+*	PreReq:		None.
+*	Side E:		None.
+*	Notes:		From the lower limit the move starts with a slow
+*				LATCH_CLEAR lift and blends into the open sweep, on a
+*				single servo cover.  The sides of a wider cover open
+*				together.
+*/
+
 	//Local variables
-	//For switch input
-	SWITCH_POS			SwitchPosArray[FILTER_SIZE];
-	SWITCH_POS			SwitchPosOld;
-	SWITCH_POS			SwitchPosNew;						//Holds value of switch position
-	SWITCH_EVENT_STRUCT	SwitchEventStruct;
-	//For Key Input
-	KEY_POS				KeyPosArray[FILTER_SIZE];
-	KEY_POS				KeyPosOld;
-	KEY_POS				KeyPosNew;							//hold value of key position
-	KEY_EVENT_STRUCT	KeyEventStruct;
-	
-	//StateNormal variables
-	//Variable to hold STATE_NORMAL open timeout info
-	uint32_t			StateNormalOpenTime;
-	//Sub-state variable indicating active edge
-	uint8_t			StateNormalEdge;
-	//Variable to hold override switch transitions for lock mode
-	uint8_t			StateNormalLockCount;
-	//Variable to hold timeout for lock mode
-	uint32_t			StateNormalLockTime;
-	//Switch transitions for demo mode
-	uint8_t			StateNormalDemoCount;
-	//Timeout for demo mode
-	uint32_t			StateNormalDemoTime;
-	
-	//STATE_LOCKED variables
-	bool				StateLockedInit;
-	//Counts switch DOWN to CENTER edges
-	uint8_t			StateLockedEdgeCount;
-	//Holds timeout value
-	uint32_t			StateLockedLockTime;
-	
-	//STATE_DEMO variables
-	uint8_t			StateDemoEdgeCount;
-	uint32_t			StateDemoTimeout;
-	bool				StateDemoCycleFlag;
-	uint32_t			StateDemoCycleTime;
-	bool				StateDemoInit;
-	uint16_t			StateDemoNormalSpeed;
-	
-	//For user implemented reset
-	uint32_t			UserReset;
+	MOTION_WAYPOINT		path[2];
+	
+	if(		LATCH_CLEAR
+		&&	( PWM_CH_NUM == 1 )
+		&&	( motionGetTarget(SERVO_CH) == ServoParamsRamPtr->LowerLimit[SERVO_CH] ) ){
+	
+		path[0].Duty	= ServoParamsRamPtr->LowerLimit[SERVO_CH] + LATCH_CLEAR;
+		path[0].Speed	= LATCH_SPEED;
+		path[1].Duty	= ServoParamsRamPtr->UpperLimit[SERVO_CH];
+		path[1].Speed	= ServoParamsRamPtr->Speed;
+		motionMovePath(SERVO_CH, path, 2);
+	
+	}//end if
+	else
+		motionMoveSync(ServoParamsRamPtr->UpperLimit, MOTION_PROFILE_TRAP);
 
+}//end OpenCover
+
+static void SetParamPeriod( uint16_t period ){
+/*	Desc:		Sets the sample period of all potentiometers.
+*	Args:		period, x 1 ms.
+*	Ret:		None.
+*	Globals:	ParamPeriod
+*	PreReq:		a2dInit() must have been called.
+*	Side E:		None.
+*	Notes:		None.
+*/
+
+	//Local variables
+	uint8_t		i;
 	
-	//Initialize global varaibles
-	//PWM Values
-	CurrentDutyCycle = PWM_CENTER_DFLT;
-	DesiredDutyCycle = PWM_CENTER_DFLT;
-	//Init flags
-	SampleFlag = FALSE;
-	//Set state
-	CurrentState = STATE_REBOOT;
-	//Misc. Inits
-	StateNormalEdge = POSEDGE;
+	ParamPeriod = period;
 	
-	//Init HW
-	IOInit();
+	for( i = 0; i < PARAM_NUM; i++ )
+		a2dSetPeriod(ParamCh[i], period);
+
+}//end SetParamPeriod
+
+static void InitServoParams( void ){
+/*	Desc:		Starts the potentiometer filters at the current a2d
+*				results and sets the servo parameters from them.
+*	Args:		None.
+*	Ret:		None.
+*	Globals:	ServoParamsRam, ParamFilter
+*	PreReq:		a2dInit() must have been called.
+*	Side E:		Potentiometers are sampled at the fast rate.  The PWM
+*				frame rate is set from the parameters.
+*	Notes:		None.
+*/
 
-	//Start main infinite loop
-	for(;;){
+	//Local variables
+	uint8_t		i;
+	
+	for( i = 0; i < PARAM_NUM; i++ ){
+	
+		ParamCount[i] = a2dGetCount(ParamCh[i]);
+		filterInit(	&ParamFilter[i],
+					PARAM_ALPHA,
+					( i == PARAM_SPEED ) ? PARAM_SPEED_DEADBAND : PARAM_LIM_DEADBAND,
+					a2dGetSample(ParamCh[i]) );
+	
+	}//end for
+	
+	SetServoParams();
 	
-		//Check sample flag
-		if(SampleFlag){
+	//Frame rate, the motion engine follows the new frame length
+	motionSetFrame(SetPWMFrame(ServoParamsRamPtr->FrameRate));
+	
+	ParamQuiet = 0;
+	SetParamPeriod(PARAM_PERIOD_FAST);
+
+}//end InitServoParams
+
+static void UpdateServoParams( void ){
+/*	Desc:		Runs new potentiometer results through the filters,
+*				updates the servo parameters only if a filter output
+*				moved past its deadband, and adapts the sample period.
+*	Args:		None.
+*	Ret:		None.
+*	Globals:	ServoParamsRam, ParamFilter, ParamPeriod
+*	PreReq:		InitServoParams() must have been called.
+*	Side E:		Potentiometer sample period may change.
+*	Notes:		A pot that is being turned is sampled every
+*				PARAM_PERIOD_FAST; one that is left alone backs off to
+*				PARAM_PERIOD_SLOW.
+*/
+
+	//Local variables
+	uint8_t		i;
+	uint8_t		count;
+	bool		newResult	= FALSE;
+	bool		changed		= FALSE;
+	
+	for( i = 0; i < PARAM_NUM; i++ ){
+	
+		count = a2dGetCount(ParamCh[i]);
 		
-			//Reset Flag
-			SampleFlag = FALSE;
-			
-			//Shift and sample Data
-			//Override switch
-			SwitchPosArray[2] = SwitchPosArray[1];
-			SwitchPosArray[1] = SwitchPosArray[0];
-			SwitchPosArray[0] =	 GetSwitchPos();
-			//Ignition Key
-			KeyPosArray[2] = KeyPosArray[1];
-			KeyPosArray[1] = KeyPosArray[0];
-			KeyPosArray[0] = GetKeyPos();
-			
-			//Assign new value based on inputs after debounce filtering
-			//Check switch input
-			if( 	(SwitchPosArray[2] == SwitchPosArray[1])
-				&&	(SwitchPosArray[1] == SwitchPosArray[0]) ){
-				
-				//All of the inputs are the same, assume it has settled
-				SwitchPosNew = SwitchPosArray[0];
-				
-			}//end if
-			//Check ignition key input
-			if(		(KeyPosArray[2] == KeyPosArray[1])
-				&&	(KeyPosArray[1] == KeyPosArray[0]) ){
-				
-				//All of the inputs are the same, assume it has settled
-				KeyPosNew = KeyPosArray[0];
-				
-			}//end if		
-			
-			if( SwitchPosOld != SwitchPosNew ){
-				
-				//There was a state change on the input
-				SwitchEventStruct.SwitchPosNew 	= SwitchPosNew;
-				SwitchEventStruct.SwitchPosOld 	= SwitchPosOld;
-				INTR_OFF;
-				SwitchEventStruct.SwitchTimeNew	= MS_TIMER;
-				INTR_ON;
-				
-				//Set the flag
-				SwitchEventStruct.SwitchEventFlag = TRUE;
-			
-			}//end if Old != New
+		if( count != ParamCount[i] ){
+		
+			ParamCount[i]	= count;
+			newResult		= TRUE;
 			
-			if( KeyPosOld != KeyPosNew ){
-				
-				//There was a state change on the input
-				KeyEventStruct.KeyPosNew	= KeyPosNew;
-				KeyEventStruct.KeyPosOld	= KeyPosOld;
-				INTR_OFF;
-				KeyEventStruct.KeyTimeNew	= MS_TIMER;
-				INTR_ON;
-				
-				//Set the flag
-				KeyEventStruct.KeyEventFlag = TRUE;
+			if( filterUpdate(&ParamFilter[i], a2dGetSample(ParamCh[i])) )
+				changed = TRUE;
+		
+		}//end if
 	
-			}//end if Old != New
-			
-			//Update old values
-			SwitchPosOld	= SwitchPosNew;
-			KeyPosOld		= KeyPosNew;
-			
-			//Added 10/14/05, Scott Nortman
-			//Check the state of the user reset pin.
-			//	if asserted for > USER_RESET_TIMEOUT
-			//	reset the EEPROM values from FLASH, and
-			//	go into STATE_REBOOT.
-			if( !GET_RESET_INPUT && !UserReset ){
+	}//end for
+	
+	if( changed ){
+	
+		//Pot is moving, sample it quickly
+		SetServoParams();
+		ParamQuiet = 0;
+		if( ParamPeriod != PARAM_PERIOD_FAST )
+			SetParamPeriod(PARAM_PERIOD_FAST);
+	
+	}//end if
+	else if( newResult && ++ParamQuiet >= PARAM_QUIET_CNT ){
+	
+		//Quiet, back off
+		ParamQuiet = 0;
+		if( ParamPeriod < PARAM_PERIOD_SLOW )
+			SetParamPeriod(ParamPeriod * 2);
+	
+	}//end else if
+
+}//end UpdateServoParams
+
+static void InputTask( void ){
+/*	Desc:		Samples and debounces the switch and key inputs, checks
+*				the user reset pin, and filters new potentiometer results.
+*	Args:		None.
+*	Ret:		None.
+*	Globals:	SwitchEventStruct, KeyEventStruct, CurrentState
+*	PreReq:		IOInit() must have been called.
+*	Side E:		Makes TASK_CONTROL ready.
+*	Notes:		Runs every SAMPLE_DIV ms.  The switch is debounced on its
+*				a2d samples, by their time, so each one counts once
+*				however the task and the a2d period line up.
+*/
+
+	//Local variables
+	SWITCH_POS	switchPos;
+	uint32_t	switchUs;
+
+	//Shift and sample Data
+	//Override switch, only a new a2d sample
+	switchPos = GetSwitchPosTime(&switchUs);
+	if( switchUs != SwitchTimeArray[0] ){
+		SwitchPosArray[2] = SwitchPosArray[1];
+		SwitchPosArray[1] = SwitchPosArray[0];
+		SwitchTimeArray[2] = SwitchTimeArray[1];
+		SwitchTimeArray[1] = SwitchTimeArray[0];
+		SwitchPosArray[0] = switchPos;
+		SwitchTimeArray[0] = switchUs;
+	}//end if
+	//Ignition Key
+	KeyPosArray[2] = KeyPosArray[1];
+	KeyPosArray[1] = KeyPosArray[0];
+	KeyTimeArray[2] = KeyTimeArray[1];
+	KeyTimeArray[1] = KeyTimeArray[0];
+	KeyTimeArray[0] = timerGetUs();
+	KeyPosArray[0] = GetKeyPos();
+	
+	//Assign new value based on inputs after debounce filtering
+	//Check switch input
+	if( 	(SwitchPosArray[2] == SwitchPosArray[1])
+		&&	(SwitchPosArray[1] == SwitchPosArray[0]) ){
+		
+		//All of the inputs are the same, assume it has settled
+		SwitchPosNew = SwitchPosArray[0];
+		
+	}//end if
+	//Check ignition key input
+	if(		(KeyPosArray[2] == KeyPosArray[1])
+		&&	(KeyPosArray[1] == KeyPosArray[0]) ){
+		
+		//All of the inputs are the same, assume it has settled
+		KeyPosNew = KeyPosArray[0];
+		
+	}//end if		
+	
+	if( SwitchPosOld != SwitchPosNew ){
+		
+		//There was a state change on the input
+		SwitchEventStruct.SwitchPosNew 	= SwitchPosNew;
+		SwitchEventStruct.SwitchPosOld 	= SwitchPosOld;
+		SwitchEventStruct.SwitchTimeNew	= timerGetMs();
+		//Edge was first seen by the oldest of the debounce samples
+		SwitchEventStruct.SwitchTimeUs	= SwitchTimeArray[2];
+		
+		//Set the flag
+		SwitchEventStruct.SwitchEventFlag = TRUE;
+	
+	}//end if Old != New
+	
+	if( KeyPosOld != KeyPosNew ){
+		
+		//There was a state change on the input
+		KeyEventStruct.KeyPosNew	= KeyPosNew;
+		KeyEventStruct.KeyPosOld	= KeyPosOld;
+		KeyEventStruct.KeyTimeNew	= timerGetMs();
+		KeyEventStruct.KeyTimeUs	= KeyTimeArray[2];
+		
+		//Set the flag
+		KeyEventStruct.KeyEventFlag = TRUE;
+
+	}//end if Old != New
+	
+	//Update old values
+	SwitchPosOld	= SwitchPosNew;
+	KeyPosOld		= KeyPosNew;
+	
+	//Added 10/14/05, Scott Nortman
+	//Check the state of the user reset pin.
+	//	if asserted for > USER_RESET_TIMEOUT
+	//	reset the EEPROM values from FLASH, and
+	//	go into STATE_REBOOT.
+	if( !GET_RESET_INPUT && !UserReset ){
+	
+		//user reset pin is asserted;
+		UserReset = TRUE;
+		
 			
-				//user reset pin is asserted;
-				UserReset = TRUE;
-				
+		CurrentState = STATE_REBOOT;
 					
-				CurrentState = STATE_REBOOT;
-							
-			}//end if
-			
-			//Sample analog inputs
-			ServoParamsRamPtr->UpperLimit 	= PWM_OPEN_LIM - 3*(a2dSample(A2D_OPEN_CH)>>2);
-			ServoParamsRamPtr->LowerLimit 	= PWM_CLSD_LIM + 3*(a2dSample(A2D_CLSD_CH)>>2);
-			ServoParamsRamPtr->Speed		= a2dSample(A2D_SPEED_CH)>>4;
-			
-		}//end if(SampleFlag)
+	}//end if
+	
+	//Filter any new a2d results into the parameters
+	UpdateServoParams();
+	
+	//Let the state machine see the new inputs
+	schedReady(TASK_CONTROL);
+
+}//end InputTask
+
+static void MotionReady( void ){
+/*	Desc:		Motion service function, makes TASK_MOTION ready.
+*	Args:		None.
+*	Ret:		None.
+*	Globals:	None.
+*	PreReq:		None.
+*	Side E:		None.
+*	Notes:		Called from the TOC1 overflow ISR on arrival.
+*/
+
+	schedReady(TASK_MOTION);
+
+}//end MotionReady
+
+static void MotionTask( void ){
+/*	Desc:		Plans queued motion commands and passes motion events
+*				to the state machine.
+*	Args:		None.
+*	Ret:		None.
+*	Globals:	None.
+*	PreReq:		IOInit() must have been called.
+*	Side E:		May make TASK_CONTROL ready.
+*	Notes:		Runs when a command is queued or a move arrives.
+*/
+
+	if( motionService() )
+		schedReady(TASK_CONTROL);
+
+}//end MotionTask
+
+static void ControlTask( void ){
+/*	Desc:		Runs expired timeouts, motion events and the control
+*				state machine.
+*	Args:		None.
+*	Ret:		None.
+*	Globals:	CurrentState, ServoParamsRam
+*	PreReq:		swtimerInit() must have been called.
+*	Side E:		Servo position may change.
+*	Notes:		Runs after every InputTask(), and on motion events.
+*/
+
+	//Local variables
+	MOTION_EVENT	event;
+	uint8_t			ch;
+	uint16_t		duty;
+	const uint16_t	*demoDuty;
+	
+	//Run any expired timeouts
+	swtimerService();
+	
+	//Motion events
+	while( (event = motionGetEvent(&ch, &duty)) != MOTION_EVENT_NONE ){
+	
+		//Demo cycles as soon as the servo reaches the limit it was sent to
+		if(		( CurrentState == STATE_DEMO )
+			&&	( event == MOTION_EVENT_DONE )
+			&&	( ch == SERVO_CH )
+			&&	( duty == motionGetTarget(SERVO_CH) ) )
+			StateDemoCycleFlag = TRUE;
+	
+	}//end while
+	
+	//State Machine
+	if		(CurrentState == STATE_REBOOT){
+	
+		//Initialize Input states
+		SwitchEventStruct.SwitchPosOld 		= GetSwitchPos();
+		SwitchEventStruct.SwitchPosNew 		= SwitchEventStruct.SwitchPosOld;
+		SwitchEventStruct.SwitchEventFlag 	= TRUE;
+		SwitchEventStruct.SwitchTimeNew		= timerGetMs();
+		SwitchEventStruct.SwitchTimeUs		= timerGetUs();
 		
+		KeyEventStruct.KeyPosOld			= GetKeyPos();
+		KeyEventStruct.KeyPosNew			= KeyEventStruct.KeyPosOld;
+		KeyEventStruct.KeyEventFlag 		= TRUE;
+		KeyEventStruct.KeyTimeNew			= timerGetMs();
+		KeyEventStruct.KeyTimeUs			= timerGetUs();
+
+		//Init values
+		//STATE_NORMAL variables
+		StateNormalAccReady		= FALSE;
+		StateNormalEdge			= POSEDGE;
+		StateNormalLockCount	= 0;
+		StateNormalDemoCount	= 0;
+		//STATE_LOCKED
+		StateLockedInit			= FALSE;
+		StateLockedEdgeCount	= 0;
+		//STATE_DEMO
+		StateDemoEdgeCount		= 0;
+		StateDemoCycleFlag		= FALSE;
+		StateDemoInit			= FALSE;
+		//User reset
+		UserReset				= FALSE;
 		
-		//State Machine
-		if		(CurrentState == STATE_REBOOT){
+		//Timeouts
+		swtimerStop(&NormalLockTimer);
+		swtimerStop(&NormalDemoTimer);
+		swtimerStop(&LockedTimer);
+		swtimerStop(&DemoEdgeTimer);
+		swtimerStart(&AccTimer, ACC_TIMEOUT, SetFlag, &StateNormalAccReady);
 		
-			//Initialize Input states
-			SwitchEventStruct.SwitchPosOld 		= GetSwitchPos();
-			SwitchEventStruct.SwitchPosNew 		= SwitchEventStruct.SwitchPosOld;
-			SwitchEventStruct.SwitchEventFlag 	= TRUE;
-			INTR_OFF;
-			SwitchEventStruct.SwitchTimeNew		= MS_TIMER;
-			INTR_ON;
-			
-			KeyEventStruct.KeyPosOld			= GetKeyPos();
-			KeyEventStruct.KeyPosNew			= KeyEventStruct.KeyPosOld;
-			KeyEventStruct.KeyEventFlag 		= TRUE;
-			INTR_OFF;
-			KeyEventStruct.KeyTimeNew			= MS_TIMER;
-			INTR_ON;
-
-			//Init values
-			//STATE_NORMAL variables
-			StateNormalOpenTime		= 0;
-			StateNormalEdge			= POSEDGE;
-			StateNormalLockCount	= 0;
-			StateNormalLockTime		= 0;
-			StateNormalDemoCount	= 0;
-			StateNormalDemoTime		= 0;
-			//STATE_LOCKED
-			StateLockedInit			= FALSE;
-			StateLockedEdgeCount	= 0;
-			StateLockedLockTime		= 0;
-			//STATE_DEMO
-			StateDemoEdgeCount		= 0;
-			StateDemoTimeout		= 0;
-			StateDemoCycleFlag		= FALSE;
-			StateDemoCycleTime		= 0;
-			StateDemoInit			= FALSE;
-			//User reset
-			UserReset				= FALSE;
-			
-			ServoParamsRamPtr->UpperLimit 	= PWM_OPEN_LIM - 3*(a2dSample(A2D_OPEN_CH)>>2);
-			ServoParamsRamPtr->LowerLimit 	= PWM_CLSD_LIM + 3*(a2dSample(A2D_CLSD_CH)>>2);
-			ServoParamsRamPtr->Speed		= a2dSample(A2D_SPEED_CH)>>4;
-			
-			//Initialize watchdog timer for 500 ms timeout
-			wdt_enable(WDTO_500MS);
+		InitServoParams();
+		
+		//Initialize watchdog timer for 500 ms timeout
+		wdt_enable(WDTO_500MS);
+		
+		//Set next state to NORMAL
+		CurrentState = STATE_NORMAL;
+		
+	}//end STATE_REBOOT
+	else if(CurrentState == STATE_NORMAL){
+	/*	Note:  Within this "Superstate" there
+	*	are substates.
+	*
+	*/
+	
+		//Handle NORMAL operation
+		//Combinatorial events
+		if		(SwitchPosNew == UP){
+		
+			//Set open duty cycle
+			OpenCover();
+		}
+		else if(SwitchPosNew == DOWN){
 			
-			//Set next state to NORMAL
-			CurrentState = STATE_NORMAL;
+			//Set servos to lower limits
+			motionMoveSync(ServoParamsRamPtr->LowerLimit, MOTION_PROFILE_TRAP);
+		}//end DOWN
+		else if(SwitchPosNew == CENTER){
 			
-		}//end STATE_REBOOT
-		else if(CurrentState == STATE_NORMAL){
-		/*	Note:  Within this "Superstate" there
-		*	are substates.
-		*
-		*/
-		
-			//Handle NORMAL operation
-			//Combinatorial events
-			if		(SwitchPosNew == UP){
+			//Check for open timeout
+			if( 	StateNormalAccReady
+				&&	( KeyEventStruct.KeyPosNew == ON ) ){
 			
-				//Set open duty cycle
-				//INTR_OFF;
-				//DesiredDutyCycle = ServoParamsRamPtr->UpperLimit;
-				//INTR_ON;
-				SetPWMDuty(2000);
+				OpenCover();
+
 			}
-			else if(SwitchPosNew == DOWN){
-				
-				//Set servo to lower limit
-				//INTR_OFF;
-				//DesiredDutyCycle = ServoParamsRamPtr->LowerLimit;
-				//INTR_ON;	
-				SetPWMDuty(1000);
-			}//end DOWN
-			else if(SwitchPosNew == CENTER){
-				
-				//Check for open timeout
-				INTR_OFF;
-				if( 	((MS_TIMER - StateNormalOpenTime) > ACC_TIMEOUT)
-					&&	( KeyEventStruct.KeyPosNew == ON ) ){
-				
-					DesiredDutyCycle = ServoParamsRamPtr->UpperLimit;
+			
+		}//end SwitchPosNew == CENTER
+		
+		//For lock mode, the ignition key must be on, and we must get the
+		//	proper edges from the over ride switch:  Four UP to CENTER
+		//	transitions in under 3 seconds will place the cover in lock
+		//	mode.
+		if( 0){//KeyPosNew == ON ){
 	
-				}
-				INTR_ON;
-				
-			}//end SwitchPosNew == CENTER
+			//Look for edges to put cover in the lock mode
+			if (SwitchEventStruct.SwitchEventFlag){
 			
-			//For lock mode, the ignition key must be on, and we must get the
-			//	proper edges from the over ride switch:  Four UP to CENTER
-			//	transitions in under 3 seconds will place the cover in lock
-			//	mode.
-			if( 0){//KeyPosNew == ON ){
-		
-				//Look for edges to put cover in the lock mode
-				if (SwitchEventStruct.SwitchEventFlag){
-				
-					//Look for UP to CENTER switch transitions
-					if(		(SwitchEventStruct.SwitchPosOld == UP)
-						&&	(SwitchEventStruct.SwitchPosNew == CENTER) ){
-						
-						if( !StateNormalLockCount ){
-						
-							//The count is zero, so grab the starting time;
-							//Grab Starting time
-							StateNormalLockTime = SwitchEventStruct.SwitchTimeNew;
-							
-							//Increment count
-							StateNormalLockCount++;
-						
-						}//end !StateNormalLockCount
-						else{
-						
-							//We have a non-zero count value, so keep incrementing
-							StateNormalLockCount++;
-							
-							//See if we've reached the needed counts within the time limit
-							if(		( StateNormalLockCount >= LOCKED_CNT_REQ )
-								&&	( ( SwitchEventStruct.SwitchTimeNew - StateNormalLockTime ) <= LOCKED_TIMEOUT ) ){
-								
-								//We've reached the reqired counts within the timeout
-								//clear count
-								StateNormalLockCount = 0;
-								//set new state
-								CurrentState = STATE_LOCKED;
-								
-							}//end if
-						
-						}//end else
+				//Look for UP to CENTER switch transitions
+				if(		(SwitchEventStruct.SwitchPosOld == UP)
+					&&	(SwitchEventStruct.SwitchPosNew == CENTER) ){
+					
+					if( !StateNormalLockCount ){
+					
+						//The count is zero, so start the window;
+						//	the count is cleared if it runs out
+						swtimerStart(&NormalLockTimer, LOCKED_TIMEOUT, ClearCount, &StateNormalLockCount);
 						
-					}//end UP to CENTER
-					//We also need to check for STATE_DEMO by watching CENTER to DOWN transitions
-					//To enter this mode, the follow sequence is required:	key = ON,
-					//	switch = CENTER -> DOWN x 10 in 5 seconds.
-					else if(	( SwitchEventStruct.SwitchPosOld == CENTER )
-							 &&	( SwitchEventStruct.SwitchPosNew == DOWN)	){
-							 
-						//Falling edge
-						if( !StateNormalDemoCount ){
+						//Increment count
+						StateNormalLockCount++;
+					
+					}//end !StateNormalLockCount
+					else{
+					
+						//We have a non-zero count value, so keep incrementing
+						StateNormalLockCount++;
 						
-							//Grab start time
-							StateNormalDemoTime = SwitchEventStruct.SwitchTimeNew;
+						//See if we've reached the needed counts within the time limit
+						if( StateNormalLockCount >= LOCKED_CNT_REQ ){
 							
-							//Increment count
-							StateNormalDemoCount++;
-						
-						}//end !StateNormalDemoCount
-						else{
-						
-							//Non-zero count already; so keep incrementing
-							StateNormalDemoCount++;
+							//We've reached the reqired counts within the timeout
+							//clear count
+							swtimerStop(&NormalLockTimer);
+							StateNormalLockCount = 0;
+							//set new state
+							CurrentState = STATE_LOCKED;
 							
-							//See if we've reached the needed counts within the time limits
-							if(		(StateNormalDemoCount >= DEMO_CNT_REQ )
-								&&	( (SwitchEventStruct.SwitchTimeNew - StateNormalDemoTime ) <= DEMO_TIMEOUT ) ){
-								
-								StateNormalDemoCount = 0;
-								
-								CurrentState = STATE_DEMO;
-								
-							}//end if
+						}//end if
+					
+					}//end else
+					
+				}//end UP to CENTER
+				//We also need to check for STATE_DEMO by watching CENTER to DOWN transitions
+				//To enter this mode, the follow sequence is required:	key = ON,
+				//	switch = CENTER -> DOWN x 10 in 5 seconds.
+				else if(	( SwitchEventStruct.SwitchPosOld == CENTER )
+						 &&	( SwitchEventStruct.SwitchPosNew == DOWN)	){
+						 
+					//Falling edge
+					if( !StateNormalDemoCount ){
+					
+						//Start the window
+						swtimerStart(&NormalDemoTimer, DEMO_TIMEOUT, ClearCount, &StateNormalDemoCount);
 						
-						}//end else
-							 
-					}//end CENTER to DOWN
+						//Increment count
+						StateNormalDemoCount++;
 					
-					//Reset Flag
-					SwitchEventStruct.SwitchEventFlag = FALSE;
-				
-				}//end SwitchEventFlag
-		
-			}//end KeyPosNew == ON
-			
-			//Timeouts
-			//Turn off interrrupts
-			INTR_OFF;
-			
-			//Handle StateNormalLockCount timeout
-			if(	(MS_TIMER - StateNormalLockTime) > LOCKED_TIMEOUT ){
-			
-				//We've timedout, reset count
-				StateNormalLockCount = 0;
-			
-			}//end > LOCKED_TIMEOUT
-			
-			//StateNormalDemoTime timeout
-			if( (MS_TIMER - StateNormalDemoTime) > DEMO_TIMEOUT ){
-			
-				StateNormalDemoCount = 0;
-			
-			}//end if
-			
-			//Turn interrupts back on
-			INTR_ON;
-			
-		}//end STATE_NORMAL		
-		else if(CurrentState == STATE_LOCKED){
-		
-			//We need to set the servo to the closed position if
-			//	we're not yet initialized
-			if( !StateLockedInit ){
-			
-				//Set the servo position
-				INTR_OFF;
-				DesiredDutyCycle = ServoParamsRamPtr->LowerLimit;
-				INTR_ON;
-				
-				//Reset variables
-				StateLockedEdgeCount	= 0;
-				StateLockedLockTime		= 0;
-				//Set the flag
-				StateLockedInit 		= TRUE;
-			
-			}//end if
-			else{
-			
-				//You can only exit lock mode if key is on
-				if( KeyPosNew == ON ){
-			
-					//We've been initilized, so just look for the
-					//	needed edges to exit this state
-					if( SwitchEventStruct.SwitchEventFlag ){
+					}//end !StateNormalDemoCount
+					else{
 					
-						//Look for proper edges within timeout
-						if(		( SwitchEventStruct.SwitchPosOld == DOWN )
-							&&	( SwitchEventStruct.SwitchPosNew == CENTER) ){
-							
-							//We have a DOWN to CENTER rising edge
-							if( !StateLockedEdgeCount ){
-							
-								//This is the first rising edge
-								//Grab the time
-								StateLockedLockTime = SwitchEventStruct.SwitchTimeNew;
-								
-								//Increment the count
-								StateLockedEdgeCount++;
+						//Non-zero count already; so keep incrementing
+						StateNormalDemoCount++;
+						
+						//See if we've reached the needed counts within the time limits
+						if( StateNormalDemoCount >= DEMO_CNT_REQ ){
 							
-							}//end !EdgeCount
-							else{
+							swtimerStop(&NormalDemoTimer);
+							StateNormalDemoCount = 0;
 							
-								//We've already gotten an edge
-								//Increment the count
-								StateLockedEdgeCount++;
-								
-								//See if we have enough edges before the timeout
-								if(		( StateLockedEdgeCount >= LOCKED_CNT_REQ )
-									&&	( ( SwitchEventStruct.SwitchTimeNew - StateLockedLockTime ) <= LOCKED_TIMEOUT ) ){
-									
-									//We have enough edges before the timeout
-									//Reset the init flag
-									StateLockedInit = FALSE;
-									
-									//Reset edge count
-									StateLockedEdgeCount	= 0;
-									
-									//Set state
-									CurrentState = STATE_NORMAL;
-									
-								}//end if
-									
-							}//end else
+							CurrentState = STATE_DEMO;
 							
-						}//end DOWN to CENTER
-					
-						//Reset Flag
-						SwitchEventStruct.SwitchEventFlag = FALSE;
+						}//end if
 					
-					}//end SwitchEventFlag
+					}//end else
+						 
+				}//end CENTER to DOWN
 				
-				}//end if KeyPosNew == ON;
-			
-			}//end else
-			
-			
-			//Check for timeout
-			INTR_OFF;
-			if( (MS_TIMER - StateLockedLockTime) > LOCKED_TIMEOUT ){
-			
-				//Reset edge count
-				StateLockedEdgeCount	= 0;
+				//Reset Flag
+				SwitchEventStruct.SwitchEventFlag = FALSE;
 			
-			}//end if
-			INTR_ON;
+			}//end SwitchEventFlag
+	
+		}//end KeyPosNew == ON
 		
-		}//end STATE_LOCKED
-		else if(CurrentState == STATE_DEMO ){
+	}//end STATE_NORMAL		
+	else if(CurrentState == STATE_LOCKED){
+	
+		//We need to set the servo to the closed position if
+		//	we're not yet initialized
+		if( !StateLockedInit ){
 		
-			//This is for demonstration purposes only.
-			//	It will cause the servo to oscillate between
-			//	the upper and lower limit.
-			//Code to exit this state
-			
-			if(!StateDemoInit){
-			
-				StateDemoNormalSpeed = ServoParamsRamPtr->Speed;
-				
-				
-				INTR_OFF;
-				ServoParamsRamPtr->Speed = DEMO_SPEED;
-				INTR_ON;
-				
-				StateDemoInit = TRUE;
-			
-			}//end !Init
+			//Close and park the servos, PWM goes off when they get there
+			for( ch = 0; ch < PWM_CH_NUM; ch++ )
+				motionSetPark(ch, ServoParamsRamPtr->LowerLimit[ch]);
+			motionParkSync();
 			
+			//Reset variables
+			StateLockedEdgeCount	= 0;
+			swtimerStop(&LockedTimer);
+			//Set the flag
+			StateLockedInit 		= TRUE;
+		
+		}//end if
+		else{
+		
+			//You can only exit lock mode if key is on
 			if( KeyPosNew == ON ){
-			
-				//Check for switch edges
+		
+				//We've been initilized, so just look for the
+				//	needed edges to exit this state
 				if( SwitchEventStruct.SwitchEventFlag ){
 				
-					if(		( SwitchEventStruct.SwitchPosOld == CENTER )
-						&&	( SwitchEventStruct.SwitchPosNew == DOWN ) ) {
+					//Look for proper edges within timeout
+					if(		( SwitchEventStruct.SwitchPosOld == DOWN )
+						&&	( SwitchEventStruct.SwitchPosNew == CENTER) ){
 						
-						if(!StateDemoEdgeCount){
+						//We have a DOWN to CENTER rising edge
+						if( !StateLockedEdgeCount ){
 						
-							//Grab time
-							StateDemoTimeout = SwitchEventStruct.SwitchTimeNew;
+							//This is the first rising edge
+							//Start the window
+							swtimerStart(&LockedTimer, LOCKED_TIMEOUT, ClearCount, &StateLockedEdgeCount);
 							
-							//Increment count
-							StateDemoEdgeCount++;
+							//Increment the count
+							StateLockedEdgeCount++;
 						
 						}//end !EdgeCount
 						else{
 						
-							//Increment count
-							StateDemoEdgeCount++;
+							//We've already gotten an edge
+							//Increment the count
+							StateLockedEdgeCount++;
 							
-							if( 	( StateDemoEdgeCount >= DEMO_CNT_REQ )
-								&&	( ( SwitchEventStruct.SwitchTimeNew - StateDemoTimeout ) <= DEMO_TIMEOUT) ){
-								
-								StateDemoEdgeCount = 0;
+							//See if we have enough edges before the timeout
+							if( StateLockedEdgeCount >= LOCKED_CNT_REQ ){
 								
-								StateDemoInit = FALSE;
+								//We have enough edges before the timeout
+								swtimerStop(&LockedTimer);
+
+								//Reset the init flag
+								StateLockedInit = FALSE;
 								
-								INTR_OFF;
-								ServoParamsRamPtr->Speed = StateDemoNormalSpeed;
-								INTR_ON;
+								//Reset edge count
+								StateLockedEdgeCount	= 0;
 								
+								//Set state
 								CurrentState = STATE_NORMAL;
 								
 							}//end if
-						
+								
 						}//end else
 						
-					}//end CENTER to DOWN				
+					}//end DOWN to CENTER
 				
-					//Reset flag
+					//Reset Flag
 					SwitchEventStruct.SwitchEventFlag = FALSE;
-					
+				
 				}//end SwitchEventFlag
 			
-			}//end if KeyPosNew == ON
+			}//end if KeyPosNew == ON;
+		
+		}//end else
+	
+	}//end STATE_LOCKED
+	else if(CurrentState == STATE_DEMO ){
+	
+		//This is for demonstration purposes only.
+		//	It will cause the servo to oscillate between
+		//	the upper and lower limit.
+		//Code to exit this state
+		
+		if(!StateDemoInit){
+		
+			StateDemoNormalSpeed = ServoParamsRamPtr->Speed;
 			
-			//Cycle from upper to lower limit and back
-			if(StateDemoCycleFlag){
 			
-				if(DesiredDutyCycle == ServoParamsRamPtr->UpperLimit){
-					INTR_OFF;
-					DesiredDutyCycle = ServoParamsRamPtr->LowerLimit;
-					StateDemoCycleTime = MS_TIMER;
-					INTR_ON;
-				}//end if
-				else{
-					INTR_OFF;
-					DesiredDutyCycle = ServoParamsRamPtr->UpperLimit;
-					StateDemoCycleTime = MS_TIMER;
-					INTR_ON;
-				}
-				
-				StateDemoCycleFlag = FALSE;
-					
-			}//end if
-
-			//Handle timeouts
-			//Turn off interrupts
-			INTR_OFF;
-			//Check for edge timeout
-			if( (MS_TIMER - StateDemoTimeout) > DEMO_TIMEOUT){
+			ServoParamsRamPtr->Speed = DEMO_SPEED;
+			motionSetSpeed(DEMO_SPEED);
 			
-				StateDemoEdgeCount = 0;
+			//Start cycling right away
+			StateDemoCycleFlag = TRUE;
 			
-			}//end if
+			StateDemoInit = TRUE;
+		
+		}//end !Init
+		
+		if( KeyPosNew == ON ){
+		
+			//Check for switch edges
+			if( SwitchEventStruct.SwitchEventFlag ){
 			
-			//check for cycle timeout
-			if( (MS_TIMER - StateDemoCycleTime) > DEMO_CYCLE_TIME){
-
-				//Reset Flag
-				StateDemoCycleFlag = TRUE;
+				if(		( SwitchEventStruct.SwitchPosOld == CENTER )
+					&&	( SwitchEventStruct.SwitchPosNew == DOWN ) ) {
+					
+					if(!StateDemoEdgeCount){
+					
+						//Start the window
+						swtimerStart(&DemoEdgeTimer, DEMO_TIMEOUT, ClearCount, &StateDemoEdgeCount);
+						
+						//Increment count
+						StateDemoEdgeCount++;
+					
+					}//end !EdgeCount
+					else{
+					
+						//Increment count
+						StateDemoEdgeCount++;
+						
+						if( StateDemoEdgeCount >= DEMO_CNT_REQ ){
+							
+							swtimerStop(&DemoEdgeTimer);
+							StateDemoEdgeCount = 0;
+							
+							StateDemoInit = FALSE;
+							
+							ServoParamsRamPtr->Speed = StateDemoNormalSpeed;
+							motionSetSpeed(StateDemoNormalSpeed);
+							
+							CurrentState = STATE_NORMAL;
+							
+						}//end if
+					
+					}//end else
+					
+				}//end CENTER to DOWN				
 			
+				//Reset flag
+				SwitchEventStruct.SwitchEventFlag = FALSE;
+				
+			}//end SwitchEventFlag
+		
+		}//end if KeyPosNew == ON
+		
+		//Cycle from upper to lower limit and back
+		//	Full travel moves that are never cut short, use the S-curve
+		if(StateDemoCycleFlag){
+		
+			if(motionGetTarget(SERVO_CH) == ServoParamsRamPtr->UpperLimit[SERVO_CH]){
+				demoDuty = ServoParamsRamPtr->LowerLimit;
 			}//end if
+			else{
+				demoDuty = ServoParamsRamPtr->UpperLimit;
+			}
 			
-			//Turn interrutps back on
-			INTR_ON;
-			
-		}//end STATE_DEMO
+			//Flag is set again when the servo gets there
+			if( motionMoveSync(demoDuty, MOTION_PROFILE_SCURVE) )
+				StateDemoCycleFlag = FALSE;
+				
+		}//end if
 		
-		//Reset WDT
-		wdt_reset();
+	}//end STATE_DEMO
+
+}//end ControlTask
+
+static void WdtTask( void ){
+/*	Desc:		Resets the watchdog.
+*	Args:		None.
+*	Ret:		None.
+*	Globals:	None.
+*	PreReq:		None.
+*	Side E:		None.
+*	Notes:		Lowest priority, so the watchdog trips if the other
+*				tasks keep the CPU busy for more than its timeout.
+*/
+
+	//Reset WDT
+	wdt_reset();
+
+}//end WdtTask
+
+//Tasks, in priority order
+static SCHED_TASK	Tasks[TASK_NUM] = {
+	{ InputTask,	SAMPLE_DIV,	0, FALSE, 0, 0 },
+	{ MotionTask,	0,			0, FALSE, 0, 0 },
+	{ ControlTask,	0,			0, FALSE, 0, 0 },
+	{ WdtTask,		WDT_PERIOD,	0, FALSE, 0, 0 }
+};
 
-	}//end for(;;)
+//Main Routine
+int16_t main( void ){
+/*	Desc:		This is the main routine for the tCover servo control module.
+*	Args:		None.
+*	Ret:		int16_t, so compiler doesn't complain.
+*	Globals:	g_servoStateDesired
+*	PreReq:		None.
+*	Side E:		A2D inputs are sampled, PWM is generated.
+*	Notes:		The work is done by the tasks; the limit pots are
+*				converted while the scheduler is idle.
+*/
+	
+	//Initialize global varaibles
+	//Set state
+	CurrentState = STATE_REBOOT;
+	//Misc. Inits
+	StateNormalEdge = POSEDGE;
+	
+	//Tasks must be set up before the tick starts
+	schedInit(Tasks, TASK_NUM, a2dSleepService);
+	
+	//Init HW
+	IOInit();
+	swtimerInit();
+	motionSetService(MotionReady);
+	motionSetHold(HOLD_PERIOD, HOLD_BURST);
+	
+	//Handle STATE_REBOOT right away
+	schedReady(TASK_CONTROL);
+	
+	//Start the scheduler, never returns
+	schedRun();
 
 	//So compiler doesn't complain
 	return( 0 );
@@ -748,120 +1052,34 @@ int16_t main( void ){
 
 //Interrupt service routine for TOC2 compare match
 SIGNAL(SIG_OUTPUT_COMPARE2){
-#if 0
 /*	Desc:		This is the interrupt routine for the tCover servo control module.
 *				It runs on a successful compare match of OC2.
 *	Args:		None.
 *	Ret:		None.
 *	Globals:	g_servoStateDesired
 *	PreReq:		OC2 interrupts need to be configured for this ISR to run.
-*	Side E:		PWM Changes.
-*	Notes:		None.
+*	Side E:		Tick length changes.
+*	Notes:		The servo is moved by motionFrame() from the TOC1 frame
+*				ISR, not from here.
 */
 
 	//Local variables
-	static uint8_t	SampleCount;
-	static uint16_t	SpeedTimer;
-	static uint16_t	HumCount;
-	
-	//Increment the global ms count
-	MS_TIMER++;
+	uint8_t			elapsed;
+	uint16_t		next;
+	uint16_t		due;
 	
-	//Count to slow down the input sample rate
-	if(!SampleCount){
+	//Add the tick that just ended to the global ms count
+	elapsed = timerTickElapsed();
 	
-		//SampleFlag has reached 0, set the signal flag
-		SampleFlag 	= TRUE;
-		
-		//And reset the count
-		SampleCount = SAMPLE_DIV;
-	}
-	else
-		//Sample flag is still non-zero, so just decrement it
-		SampleCount--;
-	
-	//Check to see if we are in between servo steps by testing timer count
-	if(!SpeedTimer){
+	//Run the a2d sample periods, this paces the a2d
+	next = a2dTick(elapsed);
 	
-		//Limit checking of DesiredDutyCycle
-		if		( DesiredDutyCycle < PWM_CLSD_LIM )
-			DesiredDutyCycle = PWM_CLSD_LIM;
-		else if( DesiredDutyCycle > PWM_OPEN_LIM )
-			DesiredDutyCycle = PWM_OPEN_LIM;
-		
+	//Run the task periods, this paces the main loop
+	due = schedTick(elapsed);
 	
-		//Set appropriate value to move the servo at the correct rate
-		if		( CurrentDutyCycle < DesiredDutyCycle - (PWM_ADJ_RESOLUTION+1) ){
-			
-			//Add the minimum step size to the duty cycle
-			CurrentDutyCycle += PWM_ADJ_RESOLUTION;
-			
-			//Wait until pin is low
-			while( TCNT1 <= OCR1A ){};
-			
-			//Write Value to Servo
-			SetPWMDuty(CurrentDutyCycle);
-			
-			//turn on PWM
-			PWM_ON;
-			
-			SpeedTimer = ServoParamsRamPtr->Speed;
-		
-		}//end if Current < Upper
-		else if( CurrentDutyCycle > DesiredDutyCycle + (PWM_ADJ_RESOLUTION+1) ){
-			
-			//Subtract the minimum step size to the duty cycle
-			CurrentDutyCycle -= PWM_ADJ_RESOLUTION;
-			
-			//Wait until pin is low
-			while( TCNT1 <= OCR1A ){};
-			
-			//Write Value to Servo
-			SetPWMDuty(CurrentDutyCycle);
-			
-			//turn on PWM
-			PWM_ON;
-		
-			//Reset speed counter
-			SpeedTimer = ServoParamsRamPtr->Speed;
-			
-		}//end if Current > Lower
-		else{
-		
-			//Check to see if PWM is on and that we aren't counting yet
-			if( (DDRB & (1<<PB1)) && !HumCount ){
-			
-				//PWM is on, we haven't started timing, so reset the counter
-				HumCount = HUM_TIMEOUT;
-			
-			}//end if
-		
-		}//end else
-		
-	}//end if(!SpeedTimer)
-	else
-		SpeedTimer--;
-	
-	//Check hum timeout value
-	if(HumCount){
-	
-		//If HumCount is non-zero, decrement it
-		HumCount--;
-	
-		//If HumCount is zero now and we are in the NORMAL or LOCKED or DEMO state, turn off PWM
-		if(!HumCount && ( 		( CurrentState == STATE_NORMAL ) 
-							||	( CurrentState == STATE_LOCKED ) 
-							||	( CurrentState == STATE_DEMO   ) ) ){
-			
-			//We've timed out and therefore need to shut off the PWM
-			//First we need to wait until the OC2B pin is low
-			while( TCNT1 <= OCR1A ){};
-			
-			//We've checked to make sure pin is low, turn off PWM
-			PWM_OFF;
-			
-		}//end if
-	
-	}//end if
-#endif
+	//Next tick is the nearest deadline
+	if( due < next )
+		next = due;
+	timerSetNextTick(next);
+
 }//end SIG_OUTPUT_COMPARE0
@@ -0,0 +1,2142 @@
+/*	File:	motion.c
+*	Desc:	This file contains the motion engine that
+*			ramps the servo pulse width to its target.
+*	Proj:	AutoMotion
+*
+*	NOTES:
+*
+*		Moves are planned when the target is set, in main loop context, and
+*	the plan is run by motionFrame() from the TOC1 overflow ISR, once per
+*	PWM frame, since the duty can't change more often than that.  A plan
+*	is a short run length list of segments, each a number of frames and
+*	a constant step per frame in Q7 us.  Every frame the ISR adds the
+*	step to the position, counts the frame off, moves to the next segment
+*	when one runs out, and writes the duty; the double buffer makes the new
+*	width start with the next frame.  At the end of the plan the position
+*	is set to the target exactly.  There are no waits, searches,
+*	multiplies or limit checks left in the ISR.
+*
+*		The main loop drives the engine with commands, motionMoveTo(),
+*	motionStop() and motionPark(), which go in a short queue and call the
+*	service function so that motionService() is run soon after, in the
+*	main loop.  It plans each command in turn, each one replacing the
+*	move before it.  Every command ends with one event in the event
+*	queue: MOTION_EVENT_DONE when it arrives, posted after the ISR calls
+*	the service function at arrival, or MOTION_EVENT_ABORT when a later
+*	command replaced it first.  A stop slows down at the normal rate and
+*	arrives where it stops; a park moves to the park position and turns
+*	the PWM off as soon as it gets there.  motionMovePath() queues a
+*	list of waypoints, each with its own speed, as one command.
+*
+*		There are two plan buffers.  The planner fills the one the ISR is
+*	not running and flags it with the frame it starts on; the ISR
+*	switches to it at the start of that frame.  The ISR keeps stepping
+*	the old plan while the new one is worked out, so the new one is
+*	planned from where the old one will have the servo MotionLead frames
+*	on, worked out along the old plan's segments, and carries on from
+*	that position and speed exactly.  If the planning takes longer than
+*	that the plan is thrown away and made again further ahead, and
+*	MotionLead is raised to match; it drops back a frame at a time while
+*	plans are ready early.  A channel whose plan arrives first is
+*	planned from its target and is never late.  Each plan costs
+*	MOTION_PLAN_SIZE * 3 + 1 bytes of RAM, 121 bytes for 40 segments.
+*
+*		Each plan is flagged live until its command has had its event.
+*	The ISR only reports an arrival for a live plan, and flagging a new
+*	plan takes the flag off the running one, so a command that arrives
+*	while the next one is planned gets MOTION_EVENT_DONE and not also
+*	MOTION_EVENT_ABORT.
+*
+*		Every one of the PWM_CH_NUM servo channels has its own plans,
+*	position and goal in a MOTION_CH, and every command and event names
+*	its channel.  The queues, speed, acceleration and frame length are
+*	shared, and so is MotionPath, which is only used while a command is
+*	planned.  motionFrame() steps the channels in turn, so the ISR cost
+*	grows by one segment step per channel.  MOTION_PLAN_SIZE is divided
+*	between the channels to keep the plans in the same RAM.
+*
+*		motionMoveSync() moves every channel together, for covers with a
+*	servo on each side, each with its own target.  The group is queued
+*	as one command per channel and planned at the last one: each channel
+*	is planned on its own from where the plans start, the one that takes
+*	longest sets the duration, and the others run its frames with the
+*	travel scaled by the ratio of the distances, so every side is at the
+*	same fraction of its travel on every frame.  A channel that was
+*	moving at another rate is blended into its new one at the
+*	acceleration, and the ratio allows for what the blend travels.  One
+*	the lead can't carry, because the lead doesn't move, it would have
+*	to go further than the lead or the blend would outlast the lead's
+*	plan, runs its own profile and holds at its target until the lead
+*	lands.  The plans are flagged together once the whole group is
+*	planned, so every side arrives on the same frame.
+*
+*		The planner runs the profile frame by frame in Q16.  Segments are
+*	joined while the step stays within a tolerance of the segment's first
+*	step, and each segment gets the average step, with the remainder
+*	carried into the next one so nothing is lost.  The tolerance starts
+*	at 0 and is doubled until the plan fits.  A trapezoid's cruise is
+*	added to its segment in one go, so the time to plan doesn't grow
+*	with the length of the move, and the Speed top speeds are whole ISR
+*	steps so a long cruise has no remainder to carry.
+*
+*		MOTION_PROFILE_TRAP moves follow a trapezoid velocity profile.  The
+*	velocity is a whole number N of acceleration steps, so it can only
+*	go up or down by one step a frame, and the distance needed to stop
+*	from N steps is Accel * N(N-1)/2.  Each frame takes the fastest of
+*	N+1, N and N-1 that still leaves room to stop at the target after
+*	moving, Accel * N(N+1)/2 <= remaining.  N is capped by the Speed
+*	setting, rounded up, and the top step is cut to the Speed top speed
+*	itself, so every Speed cruises at its own rate and not at the whole
+*	step below it.  A new target is planned from the speed the ISR is running
+*	at, and one that is behind or too close to stop for is overshot at
+*	the normal deceleration and come back to, so the velocity never
+*	jumps.
+*
+*		A path is planned as one trapezoid through all its waypoints.  Each
+*	waypoint has an exit speed, worked back from the end: 0 where the
+*	path turns back, else the lower of the two segment speeds, cut to
+*	what the next segment can slow down from.  The stopping test slows
+*	to the exit speed instead of 0, and the step that reaches the
+*	waypoint carries on past it into the next segment, so the servo
+*	doesn't stop at each one.
+*
+*		MOTION_PROFILE_SCURVE moves follow a smootherstep curve instead,
+*	6t^5 - 15t^4 + 10t^3, which also limits jerk.  The curve is a 256
+*	entry table in flash, filled in by the compiler from MOTION_SS(), and
+*	read between entries so long moves stay smooth.  The
+*	duration comes from the move distance and Speed, so that the peak
+*	speed, 15/8 of the average, is the Speed top speed.  A new target
+*	starts a new curve from the current position, so S-curve moves are
+*	best left to finish.
+*
+*		A plan is kept to MOTION_PLAN_MS, in frames at the frame length,
+*	so a faster frame doesn't cut a slow move short and land it with a
+*	jump.  What a plan holds in frames is limited by its segments, so
+*	with more channels or a faster frame a long move may still not fit;
+*	its top speed is then raised until every leg fits in half its share
+*	of the plan, and a curve is made shorter.
+*
+*		Positions are in us whatever the TOC1 count rate, and are only
+*	turned into counts, by a shift, when the duty is written.  With
+*	PWM_HIRES the Q7 position keeps 3 of its fraction bits, 0.125 us,
+*	for the same ISR cost.
+*
+*		Speed keeps its old meaning of one PWM_ADJ_RESOLUTION step every
+*	Speed + 1 ms, now as the top speed of the profile.  The target is
+*	clamped to the PWM limits when it is set.
+*
+*		The frame length can be changed at run time with motionSetFrame().
+*	Speed, acceleration and the hum timeout are kept in ms, and the per
+*	frame step, acceleration and frame counts are worked out from them,
+*	so a faster frame gives the same motion with less delay.
+*
+*		Once the servo arrives the PWM is turned off to stop the servo
+*	humming at the ends of travel, and turned back on with the next
+*	move.  How long it stays on is worked out with each plan, as there
+*	is no feedback from the servo: a few us nudge settles at once, a
+*	long move winds up the gears and needs longer, and a move faster
+*	than the servo can slew leaves it behind when the pulse width gets
+*	there.  HUM_TIMEOUT is the most it stays on.  With a hold set by
+*	motionSetHold() it is then turned back on for a burst of a few
+*	frames every hold period, so the servo pulls back anything the wind
+*	has moved for a fraction of the current and noise of always on.  A
+*	parked channel stays off.  Each channel counts the frames its PWM
+*	was on for, motionGetPulses().
+*/
+
+#include "includes.h"
+
+//Smootherstep at i / 255, x 65535, worked out by the compiler
+#define MOTION_SS_T(i)		((i) / 255.0)
+#define MOTION_SS(i)		((uint16_t)( 65535.0 * MOTION_SS_T(i) * MOTION_SS_T(i) * MOTION_SS_T(i)	\
+								* ( MOTION_SS_T(i) * ( MOTION_SS_T(i) * 6.0 - 15.0 ) + 10.0 ) + 0.5 ))
+#define MOTION_SS4(i)		MOTION_SS(i), MOTION_SS(i + 1), MOTION_SS(i + 2), MOTION_SS(i + 3)
+#define MOTION_SS16(i)		MOTION_SS4(i), MOTION_SS4(i + 4), MOTION_SS4(i + 8), MOTION_SS4(i + 12)
+#define MOTION_SS64(i)		MOTION_SS16(i), MOTION_SS16(i + 16), MOTION_SS16(i + 32), MOTION_SS16(i + 48)
+#define MOTION_CURVE_SIZE	256
+//Triangle number n(n+1)/2, worked out in 32 bits
+#define MOTION_TRI(n)		(((uint32_t)(n) * ((uint32_t)(n) + 1))>>1)
+//Most frames a plan is made ahead of the ISR, under half the frame
+//	count's range
+#define MOTION_LEAD_MAX		64
+//Smallest step the ISR takes, Q16
+#define MOTION_ISR_STEP		((uint32_t)1<<(MOTION_SHIFT - MOTION_PLAN_SHIFT))
+//A synchronized channel's travel per lead travel is Q12, at most 1
+#define MOTION_RATIO_SHIFT	12
+//Largest ratio numerator and denominator, so numerator << 12 fits 32 bits
+#define MOTION_RATIO_LIM	0x3FFFFL
+
+//S-curve table, in flash
+static const uint16_t		MotionCurveTbl[MOTION_CURVE_SIZE] PROGMEM = {
+	MOTION_SS64(0), MOTION_SS64(64), MOTION_SS64(128), MOTION_SS64(192)
+};
+
+//One run of frames at a constant step
+typedef struct{
+	uint8_t		Frames;
+	int16_t		Step;		//x 1 us / frame, Q7
+}MOTION_SEG;
+
+typedef struct{
+	MOTION_SEG	Seg[MOTION_PLAN_SIZE];
+	uint8_t		Len;
+}MOTION_PLAN;
+
+//Planned waypoint
+typedef struct{
+	uint32_t	Target;		//x 1 us, Q16
+	uint32_t	Vel;		//top speed, x 1 us / frame, Q16
+	uint16_t	VMax;		//top speed, in acceleration steps rounded up
+	uint16_t	NExit;		//speed to pass through it at
+}MOTION_PATH_PT;
+
+//Profile generator state, positions Q16
+typedef struct{
+	uint32_t	Pos;
+	uint32_t	Target;
+	uint16_t	N;			//trapezoid speed, in acceleration steps
+	uint32_t	Step;		//trapezoid step last frame
+	int8_t		Dir;
+	bool		Done;		//last waypoint reached
+	uint8_t		Way;		//trapezoid waypoint being moved to
+	uint8_t		Ways;
+	bool		Curve;		//S-curve, else trapezoid
+	uint32_t	Start;		//S-curve start position
+	int16_t		Dist;		//S-curve signed distance, x 1 us
+	uint32_t	Phase;		//S-curve table index << 8
+	uint16_t	PhaseStep;
+	const MOTION_PLAN	*Lead;	//plan followed, scaled, else 0
+	uint8_t		LeadIdx;	//its next segment, and frames left of this one
+	uint8_t		LeadLeft;
+	int16_t		LeadStep;	//its step, x 1 us / frame, Q7
+	int32_t		LeadMoved;	//its travel so far, x 1 us, Q7
+	int32_t		Ratio;		//travel per lead travel, Q12
+	int32_t		Blend;		//step added to the scaled one this frame, Q16
+	int32_t		BlendDec;	//taken off it every frame
+	uint16_t	BlendLeft;	//frames of it left
+	int32_t		BlendMoved;	//travel it added so far, Q16
+	uint16_t	Hold;		//frames left to stay at the target once there
+}MOTION_GEN;
+
+//Commands waiting for motionService()
+typedef enum{
+	MOTION_CMD_MOVE		= 1,
+	MOTION_CMD_STOP		= 2,
+	MOTION_CMD_PARK		= 3,
+	MOTION_CMD_PATH		= 4,
+	MOTION_CMD_SYNC		= 5,
+	MOTION_CMD_SYNC_PARK	= 6
+}MOTION_CMD;
+
+typedef struct{
+	MOTION_CMD		Cmd;
+	uint8_t			Ch;
+	uint16_t		Duty;		//x 1 us, MOTION_CMD_MOVE and MOTION_CMD_SYNC only
+	MOTION_PROFILE	Profile;	//MOTION_CMD_MOVE and MOTION_CMD_SYNC only
+	uint8_t			Ways;		//waypoints queued, MOTION_CMD_PATH only, or
+								//	commands left in the group, MOTION_CMD_SYNC*
+}MOTION_CMD_STRUCT;
+
+typedef struct{
+	MOTION_EVENT	Event;
+	uint8_t			Ch;
+	uint16_t		Duty;		//target of the command, x 1 us
+}MOTION_EVENT_STRUCT;
+
+//Per channel state
+typedef struct{
+	//Plans, the ISR runs Plan[PlanRun]
+	MOTION_PLAN			Plan[2];
+	volatile uint8_t	PlanRun;
+	//Set when the other plan is ready to run, from frame PlanAt on
+	volatile bool		PlanNew;
+	volatile uint8_t	PlanAt;
+	//Target of each plan, x 1 us
+	uint16_t			PlanTarget[2];
+	//Set if the PWM is turned off as soon as the plan arrives
+	bool				PlanPark[2];
+	//Frames the PWM stays on after each plan arrives
+	uint16_t			PlanHum[2];
+	//Set while the command each plan was made for has had no event
+	volatile bool		PlanLive[2];
+	//ISR state: position, x 1 us, Q7, and the segment being run
+	volatile uint32_t	Pos;
+	volatile int16_t	Step;
+	uint8_t				SegIdx;
+	uint8_t				SegLeft;
+	//Frames left before PWM is turned off, 0 when not counting
+	uint16_t			HumCount;
+	//Frames left to the next hold burst, or to its end, 0 when not holding
+	uint16_t			HoldCount;
+	//Frames with the PWM on
+	volatile uint32_t	Pulses;
+	//Set while a plan is running
+	volatile bool		Moving;
+	//Set by the ISR when a plan arrives, with the target it arrived at
+	volatile bool		Arrived;
+	volatile uint16_t	ArrivedDuty;
+	//Planner, main loop only
+	//Set if the running plan arrives before the free one starts
+	bool				PlanStill;
+	//Target being planned for, x 1 us
+	uint16_t			Goal;
+	//Profile, park and path flags of the move being planned
+	MOTION_PROFILE		GoalProfile;
+	bool				GoalPark;
+	bool				GoalPath;
+	//Set while the move is one of a synchronized group
+	bool				GoalSync;
+	//Set while waiting for the rest of its group, with the goal before
+	bool				SyncWait;
+	uint16_t			SyncPrev;
+	//Park position, x 1 us
+	uint16_t			ParkDuty;
+	//Target of the last move command queued, 0 after a stop or park
+	uint16_t			CmdGoal;
+	MOTION_PROFILE		CmdProfile;
+}MOTION_CH;
+
+static MOTION_CH			MotionCh[PWM_CH_NUM];
+//Frames run, wraps
+static volatile uint8_t		MotionFrameCnt;
+//Frames ahead of the ISR new plans start, main loop only
+static uint8_t				MotionLead;
+
+//Planner settings, main loop only
+//Frame length, x 1 us
+static uint16_t				MotionFrameUs;
+//Frames in HUM_TIMEOUT, the longest hum time
+static uint16_t				MotionHumFrames;
+//Hold period, x 1 ms, and in frames, 0 for no hold; frames in a burst
+static uint16_t				MotionHoldMs;
+static uint16_t				MotionHoldFrames;
+static uint8_t				MotionHoldBurst;
+//Acceleration and Speed settings, x 1 us / 20 ms / 20 ms, Q16
+static uint32_t				MotionAccelRate;
+static uint16_t				MotionSpeed;
+//Acceleration, x 1 us / frame / frame, Q16
+static uint32_t				MotionAccel;
+//Largest N(N+1)/2 that can be multiplied by MotionAccel in 32 bits
+static uint32_t				MotionTriLim;
+//Top speed set by Speed, in acceleration steps
+static uint16_t				MotionVMax;
+//Speed, x 1 us / frame, Q16, that MotionVMax came from
+static uint32_t				MotionVel;
+//Longest plan, in frames
+static uint16_t				MotionPlanFrames;
+//Waypoints of the move being planned, set for a path, one channel at a time
+static MOTION_PATH_PT		MotionPath[MOTION_PATH_SIZE];
+static uint8_t				MotionPathLen;
+
+//Command and event queues, main loop only
+static MOTION_CMD_STRUCT	MotionCmdQ[MOTION_CMD_Q_SIZE];
+static uint8_t				MotionCmdHead;
+static uint8_t				MotionCmdTail;
+static MOTION_WAYPOINT		MotionWayQ[MOTION_WAY_Q_SIZE];
+static uint8_t				MotionWayHead;
+static uint8_t				MotionWayTail;
+static MOTION_EVENT_STRUCT	MotionEventQ[MOTION_EVENT_Q_SIZE];
+static uint8_t				MotionEventHead;
+static uint8_t				MotionEventTail;
+//Called when motionService() has work to do
+static void					(*MotionService)(void);
+
+static uint32_t motionSpeedVel(uint16_t speed){
+/*	Desc:		Works out the top speed for a Speed setting.
+*	Args:		speed, ms between PWM_ADJ_RESOLUTION steps, less 1.
+*	Ret:		x 1 us / frame, Q16.
+*	Notes:		x << 16 / 1000 is x * 8192 / 125, which fits 32 bits
+*				for frames up to 52 ms.  It is rounded to a step the
+*				ISR can take, so a long cruise leaves no remainder to
+*				carry into the segment after it.
+*/
+
+	//Local variables
+	uint32_t	vel;
+	
+	vel = ((uint32_t)PWM_ADJ_RESOLUTION * MotionFrameUs * 8192 / 125) / ((uint32_t)speed + 1);
+	vel = (vel + MOTION_ISR_STEP / 2) & ~(MOTION_ISR_STEP - 1);
+	
+	return vel ? vel : MOTION_ISR_STEP;
+
+}//end motionSpeedVel
+
+static uint16_t motionVMax(uint32_t vel, uint32_t accel){
+/*	Desc:		Turns a speed into acceleration steps.
+*	Args:		vel, x 1 us / frame, Q16.
+*				accel, x 1 us / frame / frame, Q16.
+*	Ret:		Steps, rounded up, at least 1.
+*/
+
+	//Local variables
+	uint32_t	steps;
+	
+	steps = (vel + accel - 1) / accel;
+	if( steps > MOTION_VMAX_LIM )
+		steps = MOTION_VMAX_LIM;
+	if( !steps )
+		steps = 1;
+	
+	return steps;
+
+}//end motionVMax
+
+static void motionScale(void){
+/*	Desc:		Works out the per frame acceleration and top speed from
+*				the settings and the frame length.
+*	Args:		None.
+*	Ret:		None.
+*	Notes:		Acceleration goes with the square of the frame length,
+*				x (us / 20000)^2, done in two halves to fit 32 bits.
+*/
+
+	//Local variables
+	uint16_t	frame = MotionFrameUs / 10;
+	uint32_t	frames;
+	
+	MotionAccel = (MotionAccelRate * frame / 2000) * frame / 2000;
+	if( !MotionAccel )
+		MotionAccel = 1;
+	
+	frames = MOTION_PLAN_MS * 1000 / MotionFrameUs;
+	if( frames > (uint32_t)MOTION_PLAN_SIZE * 0xFF )
+		frames = (uint32_t)MOTION_PLAN_SIZE * 0xFF;
+	MotionPlanFrames = frames;
+	
+	MotionTriLim	= 0xFFFFFFFF / MotionAccel;
+	MotionVel		= motionSpeedVel(MotionSpeed);
+	MotionVMax		= motionVMax(MotionVel, MotionAccel);
+
+}//end motionScale
+
+static bool motionCanStop(uint16_t n, uint16_t exit, uint32_t remaining, uint32_t top){
+/*	Desc:		Checks if moving at n steps this frame still leaves room
+*				to slow to the exit speed at the target.
+*	Args:		n, speed in acceleration steps.
+*				exit, speed to reach the target at, in acceleration steps.
+*				remaining, distance to the target, Q16.
+*				top, largest step this frame, Q16.
+*	Ret:		TRUE if the step this frame, Accel * n or top if less,
+*				plus Accel * ( n(n-1)/2 - exit(exit+1)/2 ) <= remaining.
+*/
+
+	//Local variables
+	uint32_t	tri;
+	uint32_t	step;
+	
+	if( n <= exit )
+		return TRUE;
+	
+	tri = MOTION_TRI(n);
+	
+	if( tri > MotionTriLim )
+		return FALSE;
+	
+	//Below Accel * tri, so it fits
+	step = MotionAccel * n;
+	if( step > top )
+		remaining += step - top;
+	
+	return ( MotionAccel * ( tri - MOTION_TRI(exit) ) <= remaining );
+
+}//end motionCanStop
+
+static void motionTrapNext(MOTION_GEN *gen){
+/*	Desc:		Moves the generator one frame along the trapezoid.
+*	Args:		gen, generator.
+*	Ret:		None.
+*	Notes:		Passes through a waypoint with an exit speed without
+*				stopping, carrying the rest of the step past it.
+*/
+
+	//Local variables
+	const MOTION_PATH_PT	*pt = &MotionPath[gen->Way];
+	uint32_t				remaining;
+	uint32_t				step;
+	uint32_t				cap;
+	uint16_t				n;
+	int8_t					dir;
+	
+	if( gen->Target >= gen->Pos ){
+		remaining	= gen->Target - gen->Pos;
+		dir			= 1;
+	}//end if
+	else{
+		remaining	= gen->Pos - gen->Target;
+		dir			= -1;
+	}//end else
+	
+	//The top speed is not a whole number of steps, so the top step
+	//	cruises at it.  Coming down from above it is never more than
+	//	one step below the last.
+	cap = ( gen->Step > pt->Vel + MotionAccel ) ? gen->Step - MotionAccel : pt->Vel;
+	
+	n = gen->N;
+	if( !n )
+		gen->Dir = dir;
+	
+	if( dir != gen->Dir ){
+	
+		//Target is behind, stop first
+		n--;
+	
+	}//end if
+	else if( n < pt->VMax && motionCanStop(n + 1, pt->NExit, remaining, cap) ){
+	
+		//Room to speed up
+		n++;
+	
+	}//end else if
+	else if( n && ( n > pt->VMax || !motionCanStop(n, pt->NExit, remaining, cap) ) ){
+	
+		//Slow down
+		n--;
+	
+	}//end else if
+	
+	step = MotionAccel * n;
+	if( step > cap )
+		step = cap;
+	gen->Step = step;
+	
+	if( dir == gen->Dir && n && pt->NExit && step >= remaining ){
+	
+		//Blend through the waypoint
+		if( gen->Dir > 0 )
+			gen->Pos += step;
+		else
+			gen->Pos -= step;
+		gen->Way++;
+		gen->Target = MotionPath[gen->Way].Target;
+	
+	}//end if
+	else if( dir == gen->Dir && ( !n || step >= remaining ) ){
+	
+		//Last step, or less than one acceleration step left
+		gen->Pos	= gen->Target;
+		n			= 0;
+		
+		if( gen->Way + 1 < gen->Ways ){
+			gen->Way++;
+			gen->Target = MotionPath[gen->Way].Target;
+		}//end if
+		else
+			gen->Done = TRUE;
+	
+	}//end else if
+	else if( gen->Dir > 0 )
+		gen->Pos += step;
+	else
+		gen->Pos -= step;
+	
+	gen->N = n;
+
+}//end motionTrapNext
+
+static uint16_t motionTrapCruise(MOTION_GEN *gen, uint16_t most){
+/*	Desc:		Moves the generator along a trapezoid's cruise, the
+*				frames that motionTrapNext() would run at the same
+*				step, in one go.
+*	Args:		gen, generator, just moved by motionTrapNext().
+*				most, frames to run at most.
+*	Ret:		Frames run, 0 if it isn't cruising.
+*	Notes:		It cruises while it is at the top speed and there is
+*				still room to stop after the step, and the step
+*				doesn't reach the target or waypoint.  That is
+*				remaining >= stop, so the frames left are worked out
+*				with one divide instead of a frame at a time.
+*/
+
+	//Local variables
+	const MOTION_PATH_PT	*pt = &MotionPath[gen->Way];
+	uint32_t				remaining;
+	uint32_t				stop;
+	uint32_t				step;
+	uint32_t				cap;
+	uint32_t				frames;
+	
+	if( gen->Done || !gen->N || gen->N != pt->VMax || MOTION_TRI(gen->N) > MotionTriLim )
+		return 0;
+	
+	if( gen->Dir > 0 && gen->Target > gen->Pos )
+		remaining = gen->Target - gen->Pos;
+	else if( gen->Dir < 0 && gen->Target < gen->Pos )
+		remaining = gen->Pos - gen->Target;
+	else
+		return 0;
+	
+	//Same step next frame
+	step = MotionAccel * gen->N;
+	if( step > pt->Vel )
+		step = pt->Vel;
+	if( !step || step != gen->Step )
+		return 0;
+	
+	//Room needed to carry on at it, as motionCanStop(), and to not be
+	//	the last step
+	stop = 0;
+	if( gen->N > pt->NExit ){
+		stop	= MotionAccel * ( MOTION_TRI(gen->N) - MOTION_TRI(pt->NExit) );
+		cap		= MotionAccel * gen->N - step;
+		stop	= ( stop > cap ) ? stop - cap : 0;
+	}//end if
+	if( stop <= step )
+		stop = step + 1;
+	if( remaining < stop )
+		return 0;
+	
+	frames = (remaining - stop) / step + 1;
+	if( frames > most )
+		frames = most;
+	
+	if( gen->Dir > 0 )
+		gen->Pos += step * frames;
+	else
+		gen->Pos -= step * frames;
+	
+	return frames;
+
+}//end motionTrapCruise
+
+static void motionCurveNext(MOTION_GEN *gen){
+/*	Desc:		Moves the generator one frame along the S-curve.
+*	Args:		gen, generator.
+*	Ret:		None.
+*	Notes:		Reads between table entries, so moves longer than the
+*				table still get a smooth step.
+*/
+
+	//Local variables
+	uint8_t		idx;
+	uint16_t	lo;
+	uint16_t	hi;
+	
+	gen->Phase += gen->PhaseStep;
+	
+	if( gen->Phase >= ((uint32_t)(MOTION_CURVE_SIZE - 1)<<8) ){
+	
+		//Last frame
+		gen->Pos	= gen->Target;
+		gen->Done	= TRUE;
+	
+	}//end if
+	else{
+	
+		idx	= gen->Phase>>8;
+		lo	= pgm_read_word(&MotionCurveTbl[idx]);
+		hi	= pgm_read_word(&MotionCurveTbl[idx + 1]);
+		
+		gen->Pos = gen->Start
+					+ (int32_t)gen->Dist * ( lo + (((uint32_t)hi - lo) * (uint8_t)gen->Phase>>8) );
+	
+	}//end else
+
+}//end motionCurveNext
+
+static void motionFollowPos(MOTION_GEN *gen){
+/*	Desc:		Puts a following generator at the scaled lead travel
+*				plus the blend.
+*	Args:		gen, generator.
+*	Ret:		None.
+*	Notes:		Works from the start every frame, so the rounding is
+*				not carried along.
+*/
+
+	gen->Pos = gen->Start + (uint32_t)(	( ( gen->LeadMoved * gen->Ratio )
+											>>(MOTION_RATIO_SHIFT - (MOTION_SHIFT - MOTION_PLAN_SHIFT)) )
+										+ gen->BlendMoved );
+
+}//end motionFollowPos
+
+static void motionFollowNext(MOTION_GEN *gen){
+/*	Desc:		Moves a following generator one frame along the lead's
+*				plan.
+*	Args:		gen, generator.
+*	Ret:		None.
+*	Notes:		Lands on the target on the lead's last frame.
+*/
+
+	if( !gen->LeadLeft ){
+		gen->LeadLeft	= gen->Lead->Seg[gen->LeadIdx].Frames;
+		gen->LeadStep	= gen->Lead->Seg[gen->LeadIdx].Step;
+		gen->LeadIdx++;
+	}//end if
+	
+	gen->LeadLeft--;
+	gen->LeadMoved += gen->LeadStep;
+	
+	if( gen->BlendLeft ){
+		gen->BlendMoved	+= gen->Blend;
+		gen->Blend		-= gen->BlendDec;
+		gen->BlendLeft--;
+	}//end if
+	
+	if( !gen->LeadLeft && gen->LeadIdx >= gen->Lead->Len ){
+	
+		//Last frame
+		gen->Pos	= gen->Target;
+		gen->Done	= TRUE;
+	
+	}//end if
+	else
+		motionFollowPos(gen);
+
+}//end motionFollowNext
+
+static uint16_t motionFollowCruise(MOTION_GEN *gen, uint16_t most){
+/*	Desc:		Moves a following generator along the rest of the lead's
+*				segment in one go, once the blend is over.
+*	Args:		gen, generator, just moved by motionFollowNext().
+*				most, frames to run at most.
+*	Ret:		Frames run, 0 if it is still blending.
+*	Notes:		Leaves the lead's last frame to motionFollowNext(), so
+*				it lands on the target.
+*/
+
+	//Local variables
+	uint16_t	frames = gen->LeadLeft;
+	
+	if( gen->Done || gen->BlendLeft )
+		return 0;
+	
+	if( gen->LeadIdx >= gen->Lead->Len )
+		frames--;
+	if( frames > most )
+		frames = most;
+	
+	gen->LeadLeft	-= frames;
+	gen->LeadMoved	+= (int32_t)gen->LeadStep * frames;
+	motionFollowPos(gen);
+	
+	return frames;
+
+}//end motionFollowCruise
+
+static uint16_t motionFrames(const MOTION_PLAN *plan){
+/*	Desc:		Counts a plan's frames.
+*	Args:		plan, plan.
+*	Ret:		Frames.
+*/
+
+	//Local variables
+	uint16_t	frames	= 0;
+	uint8_t		i;
+	
+	for( i = 0; i < plan->Len; i++ )
+		frames += plan->Seg[i].Frames;
+	
+	return frames;
+
+}//end motionFrames
+
+static uint16_t motionHum(const MOTION_PLAN *plan){
+/*	Desc:		Works out how long the PWM stays on after a plan
+*				arrives.
+*	Args:		plan, plan just encoded.
+*	Ret:		Frames, 1 to MotionHumFrames.
+*	Notes:		Travel counts every segment, so a path or a move that
+*				turns back holds for all of it.
+*/
+
+	//Local variables
+	uint32_t	travel	= 0;
+	uint32_t	frames	= 0;
+	uint32_t	ms;
+	uint32_t	slew;
+	uint32_t	time;
+	uint8_t		i;
+	
+	for( i = 0; i < plan->Len; i++ ){
+		travel += (uint32_t)( plan->Seg[i].Step < 0 ? -plan->Seg[i].Step : plan->Seg[i].Step ) * plan->Seg[i].Frames;
+		frames += plan->Seg[i].Frames;
+	}//end for
+	travel >>= MOTION_PLAN_SHIFT;
+	
+	ms = HUM_MIN + travel * HUM_SETTLE / 100;
+	
+	//Catch up time of a servo left behind, both x 1 ms
+	slew	= travel / SERVO_SLEW;
+	time	= frames * MotionFrameUs / 1000;
+	if( slew > time )
+		ms += slew - time;
+	
+	frames = ms * 1000 / MotionFrameUs;
+	if( frames > MotionHumFrames )
+		frames = MotionHumFrames;
+	
+	return frames ? frames : 1;
+
+}//end motionHum
+
+static bool motionEncode(MOTION_PLAN *plan, const MOTION_GEN *start, uint32_t tol){
+/*	Desc:		Runs a generator to its target and run length encodes
+*				its steps into a plan.
+*	Args:		plan, plan to fill.
+*				start, generator at the start of the move, not changed.
+*				tol, largest step difference joined into one segment, Q16.
+*	Ret:		TRUE if the plan fit.
+*/
+
+	//Local variables
+	MOTION_GEN	gen		= *start;
+	MOTION_SEG	*seg	= plan->Seg;
+	uint32_t	prev;
+	int32_t		step;
+	int32_t		first	= 0;
+	int32_t		sum		= 0;
+	int32_t		carry	= 0;
+	uint16_t	frames	= 0;
+	uint16_t	total;
+	uint16_t	ahead;
+	
+	plan->Len = 0;
+	
+	for( total = 0; ( !gen.Done || gen.Hold ) && total < MotionPlanFrames; total++ ){
+	
+		prev = gen.Pos;
+		if( gen.Done )
+			gen.Hold--;
+		else if( gen.Lead )
+			motionFollowNext(&gen);
+		else if( gen.Curve )
+			motionCurveNext(&gen);
+		else
+			motionTrapNext(&gen);
+		step = (int32_t)(gen.Pos - prev);
+		
+		//Close the segment if the step moved too far or it is full
+		if(		frames
+			&&	(	( step - first > (int32_t)tol )
+				||	( first - step > (int32_t)tol )
+				||	( frames == 0xFF ) ) ){
+		
+			if( plan->Len == MOTION_PLAN_SIZE )
+				return FALSE;
+			sum			+= carry;
+			seg->Frames	= frames;
+			seg->Step	= sum / ((int32_t)frames<<(MOTION_SHIFT - MOTION_PLAN_SHIFT));
+			carry		= sum - ((int32_t)seg->Step * frames<<(MOTION_SHIFT - MOTION_PLAN_SHIFT));
+			seg++;
+			plan->Len++;
+			frames		= 0;
+			sum			= 0;
+		
+		}//end if
+		
+		if( !frames )
+			first = step;
+		sum += step;
+		frames++;
+		
+		//A cruise or hold only adds frames at this step, run it in one go
+		if( ( !gen.Curve || gen.Done ) && frames < 0xFF ){
+			ahead = 0xFF - frames;
+			if( ahead > MotionPlanFrames - total - 1 )
+				ahead = MotionPlanFrames - total - 1;
+			prev	= gen.Pos;
+			if( gen.Done ){
+				if( ahead > gen.Hold )
+					ahead = gen.Hold;
+				gen.Hold -= ahead;
+			}//end if
+			else
+				ahead = gen.Lead ? motionFollowCruise(&gen, ahead) : motionTrapCruise(&gen, ahead);
+			sum		+= (int32_t)(gen.Pos - prev);
+			frames	+= ahead;
+			total	+= ahead;
+		}//end if
+	
+	}//end for
+	
+	if( frames ){
+	
+		if( plan->Len == MOTION_PLAN_SIZE )
+			return FALSE;
+		sum			+= carry;
+		seg->Frames	= frames;
+		seg->Step	= sum / ((int32_t)frames<<(MOTION_SHIFT - MOTION_PLAN_SHIFT));
+		plan->Len++;
+	
+	}//end if
+	
+	return TRUE;
+
+}//end motionEncode
+
+static uint32_t motionStart(MOTION_CH *c, uint8_t at, int16_t *step){
+/*	Desc:		Takes a channel's free plan and works out where the ISR
+*				will have the servo on frame at.
+*	Args:		c, channel.
+*				at, MotionFrameCnt the new plan is to start on.
+*				step, set to the step the ISR will be running then,
+*				x 1 us, Q7.
+*	Ret:		Position then, x 1 us, Q7.
+*	Side E:		Any plan waiting to run is dropped.  PlanStill is set
+*				if the running plan arrives by then.
+*	Notes:		The ISR's state is taken with interrupts off and run
+*				on along the running plan with them on; a plan is not
+*				changed while it runs.
+*/
+
+	//Local variables
+	const MOTION_PLAN	*plan;
+	uint32_t			pos;
+	int16_t				run;
+	uint8_t				idx;
+	uint8_t				left;
+	uint8_t				frames;
+	uint8_t				n;
+	bool				moving;
+	
+	INTR_OFF;
+	c->PlanNew	= FALSE;
+	plan		= &c->Plan[c->PlanRun];
+	pos			= c->Pos;
+	run			= c->Step;
+	idx			= c->SegIdx;
+	left		= c->SegLeft;
+	moving		= c->Moving;
+	frames		= ( (int8_t)(at - MotionFrameCnt) > 0 ) ? at - MotionFrameCnt : 0;
+	INTR_ON;
+	
+	c->PlanStill = !moving;
+	if( !moving )
+		run = 0;
+	
+	while( moving && frames ){
+	
+		if( !left ){
+		
+			if( idx >= plan->Len ){
+			
+				//Arrives first, and lands on the target
+				pos				= (uint32_t)c->PlanTarget[c->PlanRun]<<MOTION_PLAN_SHIFT;
+				run				= 0;
+				c->PlanStill	= TRUE;
+				break;
+			
+			}//end if
+			
+			left	= plan->Seg[idx].Frames;
+			run		= plan->Seg[idx].Step;
+			idx++;
+		
+		}//end if
+		
+		n		= ( left < frames ) ? left : frames;
+		pos		+= (int32_t)run * n;
+		left	-= n;
+		frames	-= n;
+	
+	}//end while
+	
+	*step = run;
+	return pos;
+
+}//end motionStart
+
+static void motionPlan(MOTION_CH *c, bool stop, uint8_t at, uint16_t hold){
+/*	Desc:		Plans a move of a channel to its Goal from where the ISR
+*				will be on frame at, into the free plan.
+*	Args:		c, channel.
+*				stop, if TRUE Goal is set to where the servo can
+*				stop, and the move is planned to there.
+*				at, MotionFrameCnt the plan starts on.
+*				hold, frames the plan stays at Goal after getting
+*				there, so it arrives that much later.
+*	Ret:		None.
+*	Side E:		The plan is handed to the ISR by motionPublish().
+*	Notes:		If GoalPath is set the move goes through the
+*				MotionPath waypoints, the last of which is Goal.
+*/
+
+	//Local variables
+	MOTION_GEN	gen;
+	MOTION_PLAN	*plan;
+	uint8_t		buf;
+	uint32_t	pos;
+	int16_t		step;
+	uint32_t	dist;
+	uint32_t	frames;
+	uint32_t	tol;
+	uint32_t	prev;
+	uint8_t		ways;
+	uint8_t		i;
+	uint16_t	exit;
+	
+	//Take the free plan and where the servo will be
+	pos					= motionStart(c, at, &step);
+	buf					= c->PlanRun ^ 1;
+	plan				= &c->Plan[buf];
+	gen.Pos				= pos<<(MOTION_SHIFT - MOTION_PLAN_SHIFT);
+	gen.Dir				= ( step < 0 ) ? -1 : 1;
+	gen.N				= 0;
+	gen.Step			= ((uint32_t)( step < 0 ? -step : step ))<<(MOTION_SHIFT - MOTION_PLAN_SHIFT);
+	gen.Curve			= ( !stop && !c->GoalPath && c->GoalProfile == MOTION_PROFILE_SCURVE );
+	gen.Lead			= 0;
+	gen.Hold			= hold;
+	
+	if( !gen.Curve && step ){
+	
+		//Carry on at the speed the ISR is running at
+		gen.N = (gen.Step + (MotionAccel>>1)) / MotionAccel;
+	
+	}//end if
+	
+	if( stop ){
+	
+		//Stop where slowing down at the normal rate ends up,
+		//	Accel * N(N-1)/2 on from here
+		dist = ( gen.N > 1 ) ? MotionAccel * ( MOTION_TRI(gen.N) - gen.N ) : 0;
+		if( gen.Dir > 0 )
+			pos = gen.Pos + dist;
+		else
+			pos = gen.Pos - dist;
+		c->Goal = (pos + ((uint32_t)1<<(MOTION_SHIFT - 1)))>>MOTION_SHIFT;
+		if		( c->Goal < PWM_CLSD_LIM )
+			c->Goal = PWM_CLSD_LIM;
+		else if( c->Goal > PWM_OPEN_LIM )
+			c->Goal = PWM_OPEN_LIM;
+	
+	}//end if
+	
+	if( !c->GoalPath || stop ){
+	
+		//Single move
+		MotionPath[0].Target	= (uint32_t)c->Goal<<MOTION_SHIFT;
+		MotionPath[0].Vel		= MotionVel;
+		MotionPath[0].VMax		= MotionVMax;
+		ways					= 1;
+	
+	}//end if
+	else
+		ways = MotionPathLen;
+	
+	//Top speeds fast enough for every leg to fit in half its share of
+	//	the plan, leaving the rest for speeding up and slowing down
+	frames = MotionPlanFrames / (ways * 2);
+	for( i = 0; i < ways; i++ ){
+	
+		prev = i ? MotionPath[i - 1].Target : gen.Pos;
+		dist = ( MotionPath[i].Target > prev ) ? MotionPath[i].Target - prev : prev - MotionPath[i].Target;
+		
+		if( dist / frames >= MotionPath[i].Vel ){
+			MotionPath[i].Vel	= (dist / frames | (MOTION_ISR_STEP - 1)) + 1;
+			MotionPath[i].VMax	= motionVMax(MotionPath[i].Vel, MotionAccel);
+		}//end if
+	
+	}//end for
+	
+	//Work back from the end for the speed each waypoint can be passed
+	//	at.  It is 0 where the path turns back, and no more than the
+	//	next segment can slow down from, or overshoot by in one step.
+	MotionPath[ways - 1].NExit = 0;
+	for( i = ways - 1; i--; ){
+	
+		prev = i ? MotionPath[i - 1].Target : gen.Pos;
+		exit = 0;
+		
+		if(		( MotionPath[i].Target > prev && MotionPath[i + 1].Target > MotionPath[i].Target )
+			||	( MotionPath[i].Target < prev && MotionPath[i + 1].Target < MotionPath[i].Target ) ){
+		
+			dist = ( MotionPath[i + 1].Target > MotionPath[i].Target ) ?
+						MotionPath[i + 1].Target - MotionPath[i].Target :
+						MotionPath[i].Target - MotionPath[i + 1].Target;
+			dist /= MotionAccel;
+			
+			exit = ( MotionPath[i].VMax < MotionPath[i + 1].VMax ) ? MotionPath[i].VMax : MotionPath[i + 1].VMax;
+			if( exit > dist )
+				exit = dist;
+			while(		exit > MotionPath[i + 1].NExit
+					&&	MOTION_TRI(exit) - MOTION_TRI(MotionPath[i + 1].NExit) > dist )
+				exit--;
+		
+		}//end if
+		
+		MotionPath[i].NExit = exit;
+	
+	}//end for
+	
+	gen.Way		= 0;
+	gen.Ways	= ways;
+	gen.Target	= MotionPath[0].Target;
+	gen.Done	= ( ways == 1 && !gen.N && gen.Pos == gen.Target );
+	
+	if( gen.Curve ){
+	
+		//Curve from where the servo is now, sized so the peak
+		//	speed is the top speed
+		dist			= ( gen.Target > gen.Pos ) ? gen.Target - gen.Pos : gen.Pos - gen.Target;
+		frames			= (dist * 15) / (MotionVel * 8) + 2;
+		if( frames > MotionPlanFrames )
+			frames = MotionPlanFrames;
+		gen.Start		= gen.Pos;
+		gen.Dist		= (int16_t)(c->Goal - (gen.Pos>>MOTION_SHIFT));
+		gen.Phase		= 0;
+		//Rounded up so the curve ends within frames; frames is at
+		//	least 2, so it fits 16 bits
+		gen.PhaseStep	= (((uint32_t)(MOTION_CURVE_SIZE - 1)<<8) + frames - 1) / frames;
+	
+	}//end if
+	
+	//Loosen the segments until the plan fits
+	for( tol = 0; !motionEncode(plan, &gen, tol); tol = tol ? tol<<1 : (1<<(MOTION_SHIFT - MOTION_PLAN_SHIFT)) );
+	
+	c->PlanTarget[buf]	= c->Goal;
+	c->PlanPark[buf]	= c->GoalPark;
+	c->PlanHum[buf]		= motionHum(plan);
+
+}//end motionPlan
+
+static void motionFollow(MOTION_CH *c, const MOTION_CH *lead, uint8_t at){
+/*	Desc:		Plans a move of a channel to its Goal along the plan the
+*				lead channel has waiting, scaled to this channel's
+*				distance.
+*	Args:		c, channel.
+*				lead, channel just planned with motionPlan().
+*				at, MotionFrameCnt the lead's plan starts on.
+*	Ret:		None.
+*	Side E:		The plan is handed to the ISR by motionPublish().
+*	Notes:		The channel runs the lead's frames, so both arrive
+*				together, at the ratio of the distances.  A blend takes
+*				it from the step it is running at to the scaled one,
+*				fading out a step at the acceleration, so a retarget
+*				doesn't jump its speed; the ratio is worked out for
+*				the distance less what the blend travels.  If the lead
+*				doesn't move, the ratio would be over 1 or the blend
+*				wouldn't be over before the lead lands, the channel is
+*				planned on its own profile instead, and held at its
+*				goal until the lead lands.
+*/
+
+	//Local variables
+	const MOTION_PLAN	*from	= &lead->Plan[lead->PlanRun ^ 1];
+	MOTION_GEN			gen;
+	MOTION_PLAN			*plan;
+	uint8_t				buf;
+	uint8_t				i;
+	uint32_t			pos;
+	uint32_t			tol;
+	uint32_t			frames	= 0;
+	uint32_t			k		= 0;
+	uint32_t			need;
+	int16_t				step;
+	int32_t				dist;
+	int32_t				total	= 0;
+	int32_t				num;
+	int32_t				den;
+	int32_t				ratio	= 0;
+	int32_t				blend	= 0;
+	uint16_t			own;
+	bool				alone;
+	
+	//Take the free plan and where the servo will be
+	pos		= motionStart(c, at, &step);
+	buf		= c->PlanRun ^ 1;
+	plan	= &c->Plan[buf];
+	
+	//Lead's travel and frames, and this channel's travel, Q7 us
+	for( i = 0; i < from->Len; i++ ){
+		total	+= (int32_t)from->Seg[i].Step * from->Seg[i].Frames;
+		frames	+= from->Seg[i].Frames;
+	}//end for
+	dist = ((int32_t)c->Goal<<MOTION_PLAN_SHIFT) - (int32_t)pos;
+	
+	//Blend from the step it runs at to the scaled first step, fading
+	//	out over k frames, a step at most the acceleration.  It travels
+	//	(k+1)/2 times its first step, which changes the ratio and so
+	//	the first step; k only grows, and is less than frames.
+	alone = ( !total || ( dist < 0 ? -dist : dist ) > ( total < 0 ? -total : total ) );
+	if( !alone )
+		ratio = (dist<<MOTION_RATIO_SHIFT) / total;
+	while( !alone ){
+	
+		blend	= ( step - (((int32_t)from->Seg[0].Step * ratio)>>MOTION_RATIO_SHIFT) )
+					* ((int32_t)1<<(MOTION_SHIFT - MOTION_PLAN_SHIFT));
+		need	= ( (uint32_t)( blend < 0 ? -blend : blend ) + MotionAccel - 1 ) / MotionAccel;
+		if( need <= 1 && !k )
+			break;
+		if( need <= k )
+			break;
+		
+		k		= need;
+		num		= dist - (int32_t)step * (int32_t)(k + 1) / 2;
+		den		= total - (int32_t)from->Seg[0].Step * (int32_t)(k + 1) / 2;
+		while( den > MOTION_RATIO_LIM || -den > MOTION_RATIO_LIM ){
+			num	/= 2;
+			den	/= 2;
+		}//end while
+		
+		//The blend has to be over before the lead lands
+		alone	= (		k >= frames || !den || (den ^ total) < 0
+					||	num > (den < 0 ? -den : den) || -num > (den < 0 ? -den : den) );
+		if( !alone )
+			ratio = (num<<MOTION_RATIO_SHIFT) / den;
+	
+	}//end while
+	
+	if( alone ){
+	
+		//Own profile, held at the goal until the lead lands
+		motionPlan(c, FALSE, at, 0);
+		own = motionFrames(plan);
+		if( own < frames )
+			motionPlan(c, FALSE, at, frames - own);
+		return;
+	
+	}//end if
+	
+	gen.Pos			= pos<<(MOTION_SHIFT - MOTION_PLAN_SHIFT);
+	gen.Start		= gen.Pos;
+	gen.Target		= (uint32_t)c->Goal<<MOTION_SHIFT;
+	gen.Done		= FALSE;
+	gen.Curve		= FALSE;
+	gen.Lead		= from;
+	gen.LeadIdx		= 0;
+	gen.LeadLeft	= 0;
+	gen.LeadStep	= 0;
+	gen.LeadMoved	= 0;
+	gen.Ratio		= ratio;
+	gen.Blend		= k ? blend : 0;
+	gen.BlendDec	= k ? blend / (int32_t)k : 0;
+	gen.BlendLeft	= k;
+	gen.BlendMoved	= 0;
+	gen.Hold		= 0;
+	
+	//Loosen the segments until the plan fits
+	for( tol = 0; !motionEncode(plan, &gen, tol); tol = tol ? tol<<1 : (1<<(MOTION_SHIFT - MOTION_PLAN_SHIFT)) );
+	
+	c->PlanTarget[buf]	= c->Goal;
+	c->PlanPark[buf]	= c->GoalPark;
+	c->PlanHum[buf]		= motionHum(plan);
+
+}//end motionFollow
+
+static bool motionPublish(uint8_t chs, uint8_t live, uint8_t at, uint8_t *busy){
+/*	Desc:		Hands channels' free plans to the ISR, to start
+*				together on frame at.
+*	Args:		chs, bit per channel planned for frame at.
+*				live, bit per channel whose plan's command needs an
+*				event.  A move planned again for the same command
+*				only needs one if the plan it replaces has not had it.
+*				at, MotionFrameCnt the plans were made for.
+*				busy, set to a bit per channel whose last command had
+*				not had its event, and so was replaced.
+*	Ret:		FALSE if the ISR has run past frame at, and the plans
+*				have to be made again.
+*	Side E:		MotionLead is raised after a plan was late, and
+*				lowered after one was more than a frame early.
+*/
+
+	//Local variables
+	MOTION_CH	*c;
+	uint8_t		i;
+	int8_t		early;
+	bool		was;
+	
+	INTR_OFF;
+	
+	early = at - MotionFrameCnt;
+	if( early < 0 ){
+	
+		//Too late, unless every running plan will have arrived, and
+		//	the servo has stayed where it was planned from
+		for( i = 0; i < PWM_CH_NUM; i++ ){
+			if( (chs & (1<<i)) && !MotionCh[i].PlanStill ){
+				INTR_ON;
+				MotionLead = ( MotionLead - early < MOTION_LEAD_MAX ) ? MotionLead - early + 1 : MOTION_LEAD_MAX;
+				return FALSE;
+			}//end if
+		}//end for
+		at = MotionFrameCnt;
+	
+	}//end if
+	
+	*busy = 0;
+	for( i = 0; i < PWM_CH_NUM; i++ ){
+	
+		if( !(chs & (1<<i)) )
+			continue;
+		
+		//A running plan that arrived has had its event
+		c								= &MotionCh[i];
+		was								= ( c->PlanLive[0] || c->PlanLive[1] );
+		c->PlanLive[c->PlanRun]			= FALSE;
+		c->PlanLive[c->PlanRun ^ 1]		= ( (live & (1<<i)) || was );
+		c->PlanAt						= at;
+		c->PlanNew						= TRUE;
+		if( was )
+			*busy |= 1<<i;
+	
+	}//end for
+	
+	INTR_ON;
+	
+	if( early > 1 && MotionLead )
+		MotionLead--;
+	
+	return TRUE;
+
+}//end motionPublish
+
+static void motionPostEvent(MOTION_EVENT event, uint8_t ch, uint16_t duty){
+/*	Desc:		Adds an event to the event queue.
+*	Args:		event, what happened.
+*				ch, channel.
+*				duty, target of the command, x 1 us.
+*	Ret:		None.
+*	Notes:		The event is lost if the queue is full.
+*/
+
+	//Local variables
+	uint8_t		next = (MotionEventHead + 1) & (MOTION_EVENT_Q_SIZE - 1);
+	
+	if( next == MotionEventTail )
+		return;
+	
+	MotionEventQ[MotionEventHead].Event	= event;
+	MotionEventQ[MotionEventHead].Ch	= ch;
+	MotionEventQ[MotionEventHead].Duty	= duty;
+	MotionEventHead = next;
+
+}//end motionPostEvent
+
+static bool motionPutCmd(MOTION_CMD cmd, uint8_t ch, uint16_t duty, MOTION_PROFILE profile){
+/*	Desc:		Adds a command to the command queue.
+*	Args:		cmd, command.
+*				ch, channel.
+*				duty, x 1 us, MOTION_CMD_MOVE only.
+*				profile, MOTION_CMD_MOVE only.
+*	Ret:		FALSE if the queue is full.
+*	Side E:		The service function is called.
+*/
+
+	//Local variables
+	uint8_t		next = (MotionCmdHead + 1) & (MOTION_CMD_Q_SIZE - 1);
+	
+	if( next == MotionCmdTail )
+		return FALSE;
+	
+	MotionCmdQ[MotionCmdHead].Cmd		= cmd;
+	MotionCmdQ[MotionCmdHead].Ch		= ch;
+	MotionCmdQ[MotionCmdHead].Duty		= duty;
+	MotionCmdQ[MotionCmdHead].Profile	= profile;
+	MotionCmdHead = next;
+	
+	if( MotionService )
+		MotionService();
+	
+	return TRUE;
+
+}//end motionPutCmd
+
+static bool motionPlanSync(bool post){
+/*	Desc:		Plans the channels waiting in a synchronized group.
+*	Args:		post, if TRUE a channel whose move was replaced gets
+*				MOTION_EVENT_ABORT for its goal before, else the
+*				group is being planned again for the same commands.
+*	Ret:		TRUE if any events were posted.
+*	Notes:		The channel whose move takes longest from where the
+*				plans start is planned at its own speed and
+*				acceleration, and sets the duration; the others
+*				follow its plan, scaled.
+*/
+
+	//Local variables
+	MOTION_CH	*c;
+	MOTION_CH	*lead;
+	uint16_t	most;
+	uint16_t	frames;
+	uint8_t		group	= 0;
+	uint8_t		busy;
+	uint8_t		at;
+	uint8_t		i;
+	bool		posted	= FALSE;
+	
+	for( c = MotionCh; c < &MotionCh[PWM_CH_NUM]; c++ ){
+	
+		if( !c->SyncWait )
+			continue;
+		
+		c->SyncWait	= FALSE;
+		c->GoalSync	= TRUE;
+		c->GoalPath	= FALSE;
+		group		|= 1<<(c - MotionCh);
+	
+	}//end for
+	
+	if( !group )
+		return FALSE;
+	
+	//Lead first, the others follow its plan.  The plans are handed to the
+	//	ISR together, so they all start on the same frame.
+	do{
+	
+		//Each channel on its own from where it will be when the plans
+		//	start, the longest leads
+		at		= MotionFrameCnt + MotionLead;
+		lead	= 0;
+		most	= 0;
+		for( c = MotionCh; c < &MotionCh[PWM_CH_NUM]; c++ ){
+		
+			if( !(group & (1<<(c - MotionCh))) )
+				continue;
+			
+			motionPlan(c, FALSE, at, 0);
+			frames = motionFrames(&c->Plan[c->PlanRun ^ 1]);
+			if( !lead || frames > most ){
+				lead	= c;
+				most	= frames;
+			}//end if
+		
+		}//end for
+		
+		for( i = 0; i < PWM_CH_NUM; i++ ){
+			if( (group & (1<<i)) && &MotionCh[i] != lead )
+				motionFollow(&MotionCh[i], lead, at);
+		}//end for
+	
+	}while( !motionPublish(group, post ? group : 0, at, &busy) );
+	
+	for( i = 0; post && i < PWM_CH_NUM; i++ ){
+		if( busy & (1<<i) ){
+			motionPostEvent(MOTION_EVENT_ABORT, i, MotionCh[i].SyncPrev);
+			posted = TRUE;
+		}//end if
+	}//end for
+	
+	return posted;
+
+}//end motionPlanSync
+
+void motionInit(uint16_t duty){
+/*	Desc:		Starts the engine with every channel holding a position.
+*	Args:		duty, starting pulse width, x 1 us.
+*	Ret:		None.
+*	PreReq:		Must be called with interrupts off.
+*	Side E:		PWM is turned off after the hum timeout.
+*/
+
+	//Local variables
+	MOTION_CH	*c;
+	
+	MotionFrameUs		= TOC1_FRAME_US;
+	MotionHumFrames		= (uint32_t)HUM_TIMEOUT * 1000 / TOC1_FRAME_US;
+	MotionHoldMs		= 0;
+	MotionHoldFrames	= 0;
+	MotionHoldBurst		= 0;
+	MotionAccelRate		= MOTION_ACCEL_DFLT;
+	MotionSpeed			= PWM_SPEED_DFLT;
+	motionScale();
+	MotionCmdHead		= 0;
+	MotionCmdTail		= 0;
+	MotionWayHead		= 0;
+	MotionWayTail		= 0;
+	MotionEventHead		= 0;
+	MotionEventTail		= 0;
+	MotionFrameCnt		= 0;
+	MotionLead			= 0;
+	
+	for( c = MotionCh; c < &MotionCh[PWM_CH_NUM]; c++ ){
+	
+		c->Pos			= (uint32_t)duty<<MOTION_PLAN_SHIFT;
+		c->Step			= 0;
+		c->Goal			= duty;
+		c->GoalProfile	= MOTION_PROFILE_TRAP;
+		c->GoalPark		= FALSE;
+		c->GoalPath		= FALSE;
+		c->GoalSync		= FALSE;
+		c->SyncWait		= FALSE;
+		c->PlanRun		= 0;
+		c->PlanNew		= FALSE;
+		c->PlanLive[0]	= FALSE;
+		c->PlanLive[1]	= FALSE;
+		c->PlanAt		= 0;
+		c->Moving		= FALSE;
+		c->Arrived		= FALSE;
+		c->HumCount		= MotionHumFrames;
+		c->HoldCount	= 0;
+		c->Pulses		= 0;
+		c->ParkDuty		= duty;
+		c->CmdGoal		= duty;
+		c->CmdProfile	= MOTION_PROFILE_TRAP;
+	
+	}//end for
+
+}//end motionInit
+
+void motionSetService(void (*service)(void)){
+/*	Desc:		Sets the function called when motionService() has work
+*				to do.
+*	Args:		service, function to call, may be called from an ISR.
+*	Ret:		None.
+*	Notes:		Usually makes the task that calls motionService() ready.
+*/
+
+	MotionService = service;
+
+}//end motionSetService
+
+bool motionMoveTo(uint8_t ch, uint16_t duty, MOTION_PROFILE profile){
+/*	Desc:		Queues a move.
+*	Args:		ch, channel, 0 to PWM_CH_NUM - 1.
+*				duty, x 1 us, clamped to PWM_CLSD_LIM..PWM_OPEN_LIM.
+*				profile, MOTION_PROFILE_TRAP or MOTION_PROFILE_SCURVE.
+*	Ret:		FALSE if the command queue is full.
+*	PreReq:		Main loop only.
+*	Notes:		Replaces the move running when it is serviced.  Ends
+*				with MOTION_EVENT_DONE, or MOTION_EVENT_ABORT if it is
+*				replaced first.  Queuing the same move as the last one
+*				does nothing.
+*/
+
+	//Local variables
+	MOTION_CH	*c = &MotionCh[ch];
+
+	if		( duty < PWM_CLSD_LIM )
+		duty = PWM_CLSD_LIM;
+	else if( duty > PWM_OPEN_LIM )
+		duty = PWM_OPEN_LIM;
+	
+	if( duty == c->CmdGoal && profile == c->CmdProfile )
+		return TRUE;
+	
+	if( !motionPutCmd(MOTION_CMD_MOVE, ch, duty, profile) )
+		return FALSE;
+	
+	c->CmdGoal		= duty;
+	c->CmdProfile	= profile;
+	
+	return TRUE;
+
+}//end motionMoveTo
+
+bool motionStop(uint8_t ch){
+/*	Desc:		Queues a stop at the normal deceleration.
+*	Args:		ch, channel.
+*	Ret:		FALSE if the command queue is full.
+*	PreReq:		Main loop only.
+*	Notes:		Ends with MOTION_EVENT_DONE at the stopping point.
+*/
+
+	if( !motionPutCmd(MOTION_CMD_STOP, ch, 0, MOTION_PROFILE_TRAP) )
+		return FALSE;
+	
+	MotionCh[ch].CmdGoal = 0;
+	
+	return TRUE;
+
+}//end motionStop
+
+bool motionPark(uint8_t ch){
+/*	Desc:		Queues a move to the park position that turns the PWM
+*				off as soon as it arrives.
+*	Args:		ch, channel.
+*	Ret:		FALSE if the command queue is full.
+*	PreReq:		Main loop only.
+*	Notes:		Ends with MOTION_EVENT_DONE, or MOTION_EVENT_ABORT.
+*/
+
+	if( !motionPutCmd(MOTION_CMD_PARK, ch, 0, MOTION_PROFILE_TRAP) )
+		return FALSE;
+	
+	MotionCh[ch].CmdGoal = 0;
+	
+	return TRUE;
+
+}//end motionPark
+
+bool motionMovePath(uint8_t ch, const MOTION_WAYPOINT *path, uint8_t num){
+/*	Desc:		Queues a move through a list of waypoints, each with its
+*				own speed.
+*	Args:		ch, channel.
+*				path, waypoints, duty clamped to PWM_CLSD_LIM..PWM_OPEN_LIM.
+*				num, waypoints, 1 to MOTION_PATH_SIZE.
+*	Ret:		FALSE if the queues are full or num is out of range.
+*	PreReq:		Main loop only.
+*	Notes:		Trapezoid only.  The servo passes through a waypoint
+*				without stopping unless the path turns back there.  Ends
+*				with one MOTION_EVENT_DONE or MOTION_EVENT_ABORT for the
+*				last waypoint.
+*/
+
+	//Local variables
+	MOTION_CH	*c		= &MotionCh[ch];
+	uint8_t		head	= MotionWayHead;
+	uint8_t		i;
+	uint16_t	duty	= 0;
+	
+	if( !num || num > MOTION_PATH_SIZE )
+		return FALSE;
+	
+	if( ((MotionWayTail - MotionWayHead - 1) & (MOTION_WAY_Q_SIZE - 1)) < num )
+		return FALSE;
+	
+	for( i = 0; i < num; i++ ){
+	
+		duty = path[i].Duty;
+		if		( duty < PWM_CLSD_LIM )
+			duty = PWM_CLSD_LIM;
+		else if( duty > PWM_OPEN_LIM )
+			duty = PWM_OPEN_LIM;
+		
+		MotionWayQ[head].Duty	= duty;
+		MotionWayQ[head].Speed	= path[i].Speed;
+		head = (head + 1) & (MOTION_WAY_Q_SIZE - 1);
+	
+	}//end for
+	
+	//Already going there
+	if( duty == c->CmdGoal && c->CmdProfile == MOTION_PROFILE_TRAP )
+		return TRUE;
+	
+	//Waypoints are in place before the command can be serviced
+	MotionWayHead = head;
+	if( !motionPutCmd(MOTION_CMD_PATH, ch, duty, MOTION_PROFILE_TRAP) ){
+		MotionWayHead = (MotionWayHead - num) & (MOTION_WAY_Q_SIZE - 1);
+		return FALSE;
+	}//end if
+	MotionCmdQ[(MotionCmdHead - 1) & (MOTION_CMD_Q_SIZE - 1)].Ways = num;
+	
+	c->CmdGoal		= duty;
+	c->CmdProfile	= MOTION_PROFILE_TRAP;
+	
+	return TRUE;
+
+}//end motionMovePath
+
+static bool motionPutSync(MOTION_CMD cmd, const uint16_t *duty, MOTION_PROFILE profile){
+/*	Desc:		Queues one command per channel as a synchronized group.
+*	Args:		cmd, MOTION_CMD_SYNC or MOTION_CMD_SYNC_PARK.
+*				duty, target per channel, MOTION_CMD_SYNC only.
+*				profile, MOTION_CMD_SYNC only.
+*	Ret:		FALSE if the command queue can't take the whole group.
+*/
+
+	//Local variables
+	uint8_t		ch;
+	
+	if( ((MotionCmdTail - MotionCmdHead - 1) & (MOTION_CMD_Q_SIZE - 1)) < PWM_CH_NUM )
+		return FALSE;
+	
+	for( ch = 0; ch < PWM_CH_NUM; ch++ ){
+	
+		motionPutCmd(cmd, ch, duty ? duty[ch] : 0, profile);
+		MotionCmdQ[(MotionCmdHead - 1) & (MOTION_CMD_Q_SIZE - 1)].Ways = PWM_CH_NUM - 1 - ch;
+	
+	}//end for
+	
+	return TRUE;
+
+}//end motionPutSync
+
+bool motionMoveSync(const uint16_t *duty, MOTION_PROFILE profile){
+/*	Desc:		Queues a move of every channel that starts and
+*				arrives together.
+*	Args:		duty, target per channel, x 1 us, each clamped to
+*				PWM_CLSD_LIM..PWM_OPEN_LIM.
+*				profile, MOTION_PROFILE_TRAP or MOTION_PROFILE_SCURVE.
+*	Ret:		FALSE if the command queue is full.
+*	PreReq:		Main loop only.
+*	Notes:		The channel with the furthest to go moves at the
+*				normal speed and acceleration; the others are scaled
+*				to its time.  Each channel ends with its own
+*				MOTION_EVENT_DONE or MOTION_EVENT_ABORT.  A command
+*				for one channel takes it out of the group.
+*/
+
+	//Local variables
+	uint16_t	target[PWM_CH_NUM];
+	uint8_t		ch;
+	bool		same = TRUE;
+	
+	for( ch = 0; ch < PWM_CH_NUM; ch++ ){
+	
+		target[ch] = duty[ch];
+		if		( target[ch] < PWM_CLSD_LIM )
+			target[ch] = PWM_CLSD_LIM;
+		else if( target[ch] > PWM_OPEN_LIM )
+			target[ch] = PWM_OPEN_LIM;
+		
+		if( target[ch] != MotionCh[ch].CmdGoal || profile != MotionCh[ch].CmdProfile )
+			same = FALSE;
+	
+	}//end for
+	
+	//Already going there
+	if( same )
+		return TRUE;
+	
+	if( !motionPutSync(MOTION_CMD_SYNC, target, profile) )
+		return FALSE;
+	
+	for( ch = 0; ch < PWM_CH_NUM; ch++ ){
+		MotionCh[ch].CmdGoal	= target[ch];
+		MotionCh[ch].CmdProfile	= profile;
+	}//end for
+	
+	return TRUE;
+
+}//end motionMoveSync
+
+bool motionParkSync(void){
+/*	Desc:		Queues a synchronized move of every channel to its
+*				park position, each PWM turned off as it arrives.
+*	Args:		None.
+*	Ret:		FALSE if the command queue is full.
+*	PreReq:		Main loop only.
+*/
+
+	//Local variables
+	uint8_t		ch;
+	
+	if( !motionPutSync(MOTION_CMD_SYNC_PARK, 0, MOTION_PROFILE_TRAP) )
+		return FALSE;
+	
+	for( ch = 0; ch < PWM_CH_NUM; ch++ )
+		MotionCh[ch].CmdGoal = 0;
+	
+	return TRUE;
+
+}//end motionParkSync
+
+void motionSetPark(uint8_t ch, uint16_t duty){
+/*	Desc:		Sets the park position of a channel.
+*	Args:		ch, channel.
+*				duty, x 1 us.
+*	Ret:		None.
+*	Notes:		Used by the following motionPark() commands.
+*/
+
+	MotionCh[ch].ParkDuty = duty;
+
+}//end motionSetPark
+
+bool motionService(void){
+/*	Desc:		Posts arrival events and plans queued commands.
+*	Args:		None.
+*	Ret:		TRUE if any events were posted.
+*	PreReq:		Main loop only.
+*	Notes:		Commands are planned in order; each one replaces the
+*				move before it, which gets MOTION_EVENT_ABORT.  A
+*				synchronized group is planned at its last command.
+*/
+
+	//Local variables
+	MOTION_CMD_STRUCT	*cmd;
+	MOTION_WAYPOINT		*way;
+	MOTION_CH			*c;
+	uint16_t			goal;
+	bool				arrived;
+	bool				posted = FALSE;
+	uint8_t				busy;
+	uint8_t				at;
+	uint8_t				i;
+	
+	//Arrivals first, they happened before any command still queued
+	for( i = 0; i < PWM_CH_NUM; i++ ){
+	
+		c = &MotionCh[i];
+		
+		INTR_OFF;
+		arrived		= c->Arrived;
+		goal		= c->ArrivedDuty;
+		c->Arrived	= FALSE;
+		INTR_ON;
+		
+		if( arrived ){
+			motionPostEvent(MOTION_EVENT_DONE, i, goal);
+			posted = TRUE;
+		}//end if
+	
+	}//end for
+	
+	while( MotionCmdTail != MotionCmdHead ){
+	
+		cmd		= &MotionCmdQ[MotionCmdTail];
+		c		= &MotionCh[cmd->Ch];
+		goal	= c->Goal;
+		
+		c->GoalPark		= ( cmd->Cmd == MOTION_CMD_PARK || cmd->Cmd == MOTION_CMD_SYNC_PARK );
+		c->GoalPath		= ( cmd->Cmd == MOTION_CMD_PATH );
+		c->GoalSync		= FALSE;
+		c->GoalProfile	= cmd->Profile;
+		if		( cmd->Cmd == MOTION_CMD_MOVE || cmd->Cmd == MOTION_CMD_SYNC )
+			c->Goal = cmd->Duty;
+		else if( cmd->Cmd == MOTION_CMD_PARK || cmd->Cmd == MOTION_CMD_SYNC_PARK )
+			c->Goal = c->ParkDuty;
+		else if( cmd->Cmd == MOTION_CMD_PATH ){
+		
+			//Take the waypoints off their queue
+			for( i = 0; i < cmd->Ways; i++ ){
+			
+				way = &MotionWayQ[MotionWayTail];
+				MotionPath[i].Target	= (uint32_t)way->Duty<<MOTION_SHIFT;
+				MotionPath[i].Vel		= motionSpeedVel(way->Speed);
+				MotionPath[i].VMax		= motionVMax(MotionPath[i].Vel, MotionAccel);
+				MotionWayTail = (MotionWayTail + 1) & (MOTION_WAY_Q_SIZE - 1);
+			
+			}//end for
+			
+			MotionPathLen	= cmd->Ways;
+			c->Goal			= cmd->Duty;
+		
+		}//end else if
+		
+		if( cmd->Cmd == MOTION_CMD_SYNC || cmd->Cmd == MOTION_CMD_SYNC_PARK ){
+		
+			//Wait for the rest of the group
+			c->SyncWait	= TRUE;
+			c->SyncPrev	= goal;
+			if( !cmd->Ways && motionPlanSync(TRUE) )
+				posted = TRUE;
+		
+		}//end if
+		else{
+		
+			do{
+				at = MotionFrameCnt + MotionLead;
+				motionPlan(c, cmd->Cmd == MOTION_CMD_STOP, at, 0);
+			}while( !motionPublish(1<<cmd->Ch, 1<<cmd->Ch, at, &busy) );
+			
+			if( busy ){
+				motionPostEvent(MOTION_EVENT_ABORT, cmd->Ch, goal);
+				posted = TRUE;
+			}//end if
+		
+		}//end else
+		
+		MotionCmdTail = (MotionCmdTail + 1) & (MOTION_CMD_Q_SIZE - 1);
+	
+	}//end while
+	
+	return posted;
+
+}//end motionService
+
+MOTION_EVENT motionGetEvent(uint8_t *ch, uint16_t *duty){
+/*	Desc:		Takes the oldest event off the event queue.
+*	Args:		ch, set to the channel of the command.
+*				duty, set to the target of the command, x 1 us.
+*	Ret:		Event, MOTION_EVENT_NONE if there are none.
+*	PreReq:		Main loop only.
+*/
+
+	//Local variables
+	MOTION_EVENT	event;
+	
+	if( MotionEventTail == MotionEventHead )
+		return MOTION_EVENT_NONE;
+	
+	event	= MotionEventQ[MotionEventTail].Event;
+	*ch		= MotionEventQ[MotionEventTail].Ch;
+	*duty	= MotionEventQ[MotionEventTail].Duty;
+	MotionEventTail = (MotionEventTail + 1) & (MOTION_EVENT_Q_SIZE - 1);
+	
+	return event;
+
+}//end motionGetEvent
+
+uint16_t motionGetTarget(uint8_t ch){
+/*	Desc:		Returns the pulse width a channel is moving to.
+*	Args:		ch, channel.
+*	Ret:		x 1 us, of the last command serviced.
+*/
+
+	return MotionCh[ch].Goal;
+
+}//end motionGetTarget
+
+static void motionReplan(void){
+/*	Desc:		Plans the moves in progress again after the speed,
+*				acceleration or frame length changed.
+*	Args:		None.
+*	Ret:		None.
+*	Notes:		Paths are left alone, they have their own speeds.  A
+*				synchronized group is planned again as a group.
+*/
+
+	//Local variables
+	MOTION_CH	*c;
+	uint8_t		busy;
+	uint8_t		at;
+	bool		sync = FALSE;
+	
+	for( c = MotionCh; c < &MotionCh[PWM_CH_NUM]; c++ ){
+	
+		if( !( c->Moving || c->PlanNew ) || c->GoalPath )
+			continue;
+		
+		if( c->GoalSync ){
+			c->SyncWait	= TRUE;
+			sync		= TRUE;
+		}//end if
+		else{
+			do{
+				at = MotionFrameCnt + MotionLead;
+				motionPlan(c, FALSE, at, 0);
+			}while( !motionPublish(1<<(c - MotionCh), 0, at, &busy) );
+		}//end else
+	
+	}//end for
+	
+	if( sync )
+		motionPlanSync(FALSE);
+
+}//end motionReplan
+
+void motionSetSpeed(uint16_t speed){
+/*	Desc:		Sets the top speed.
+*	Args:		speed, ms between PWM_ADJ_RESOLUTION steps, less 1.
+*	Ret:		None.
+*	Notes:		A move in progress is planned again if the speed changed,
+*				unless it is a path, which has its own speeds.
+*/
+
+	if( speed == MotionSpeed )
+		return;
+	
+	MotionSpeed = speed;
+	motionScale();
+	
+	motionReplan();
+
+}//end motionSetSpeed
+
+void motionSetAccel(uint32_t accel){
+/*	Desc:		Sets the acceleration.
+*	Args:		accel, x 1 us / 20 ms / 20 ms, Q16, not 0.
+*	Ret:		None.
+*	Notes:		A move in progress is planned again, unless it is a path.
+*/
+
+	MotionAccelRate = accel;
+	motionScale();
+	
+	motionReplan();
+
+}//end motionSetAccel
+
+void motionSetFrame(uint16_t us){
+/*	Desc:		Sets the PWM frame length the engine steps at.
+*	Args:		us, frame length, x 1 us.
+*	Ret:		None.
+*	PreReq:		Main loop only, after the frame length is changed.
+*	Notes:		Speed, acceleration and the hum timeout stay the same
+*				in ms; their per frame values are worked out again.  A
+*				move in progress is planned again, unless it is a path.
+*/
+
+	if( us == MotionFrameUs )
+		return;
+	
+	MotionFrameUs = us;
+	motionScale();
+	
+	INTR_OFF;
+	MotionHumFrames = (uint32_t)HUM_TIMEOUT * 1000 / us;
+	INTR_ON;
+	motionSetHold(MotionHoldMs, MotionHoldBurst);
+	
+	motionReplan();
+
+}//end motionSetFrame
+
+void motionSetHold(uint16_t ms, uint8_t burst){
+/*	Desc:		Sets the hold that follows the hum timeout.
+*	Args:		ms, time from the start of one burst to the next, 0 to
+*				leave the PWM off.
+*				burst, frames the PWM is on for each time, 1 or more.
+*	Ret:		None.
+*	PreReq:		Main loop only.
+*	Notes:		The period is at least one frame longer than the
+*				burst.  A channel already holding changes at its next
+*				burst.
+*/
+
+	//Local variables
+	uint16_t	frames = 0;
+	
+	if( !burst )
+		burst = 1;
+	
+	if( ms ){
+		frames = (uint32_t)ms * 1000 / MotionFrameUs;
+		if( frames <= burst )
+			frames = burst + 1;
+	}//end if
+	
+	MotionHoldMs = ms;
+	
+	INTR_OFF;
+	MotionHoldFrames	= frames;
+	MotionHoldBurst		= burst;
+	INTR_ON;
+
+}//end motionSetHold
+
+uint32_t motionGetPulses(uint8_t ch){
+/*	Desc:		Returns the number of frames a channel's PWM has been
+*				on for since motionInit().
+*	Args:		ch, channel.
+*	Ret:		Pulses sent.
+*/
+
+	//Local variables
+	uint32_t	pulses;
+	
+	INTR_OFF;
+	pulses = MotionCh[ch].Pulses;
+	INTR_ON;
+	
+	return pulses;
+
+}//end motionGetPulses
+
+bool motionBusy(uint8_t ch){
+/*	Desc:		Checks if a channel is moving.
+*	Args:		ch, channel.
+*	Ret:		TRUE until the position reaches the target and no
+*				commands are waiting.
+*/
+
+	return ( MotionCh[ch].Moving || MotionCh[ch].PlanNew || MotionCmdTail != MotionCmdHead );
+
+}//end motionBusy
+
+static void motionFrameCh(MOTION_CH *c, uint8_t ch){
+/*	Desc:		Moves a channel's position one frame along its plan.
+*	Args:		c, channel.
+*				ch, its number.
+*	Ret:		None.
+*	PreReq:		TOC1 overflow ISR only.
+*	Side E:		Duty and PWM output may change.  The service
+*				function is called when the plan arrives.
+*/
+
+	//Local variables
+	const MOTION_PLAN	*plan;
+	
+	//Switch to a new plan once its frame comes
+	if( c->PlanNew && (int8_t)(MotionFrameCnt - c->PlanAt) >= 0 ){
+	
+		c->PlanRun	^= 1;
+		c->PlanNew	= FALSE;
+		c->SegIdx	= 0;
+		c->SegLeft	= 0;
+		c->Moving	= TRUE;
+	
+	}//end if
+	
+	//The pulse this frame is sent if the pin was on by last frame's
+	//	compare match
+	if( GetPWMOutput(ch) )
+		c->Pulses++;
+	
+	if( !c->Moving ){
+	
+		if( c->HumCount ){
+		
+			//We've timed out and therefore need to shut off the PWM,
+			//	the hold bursts start a period later
+			if( !--c->HumCount ){
+				SetPWMOutput(ch, FALSE);
+				c->HoldCount = MotionHoldFrames;
+			}//end if
+		
+		}//end if
+		else if( c->HoldCount && !--c->HoldCount ){
+		
+			//Start or end a burst, the pin switches at the compare
+			//	match so a burst of N frames sends N whole pulses
+			if( GetPWMOutput(ch) ){
+				SetPWMOutput(ch, FALSE);
+				c->HoldCount = MotionHoldFrames ? MotionHoldFrames - MotionHoldBurst : 0;
+			}//end if
+			else{
+				SetPWMOutput(ch, TRUE);
+				c->HoldCount = MotionHoldBurst;
+			}//end else
+		
+		}//end else if
+		
+		return;
+	
+	}//end if
+	
+	plan = &c->Plan[c->PlanRun];
+	
+	if( !c->SegLeft ){
+	
+		if( c->SegIdx < plan->Len ){
+		
+			//Next segment
+			c->SegLeft	= plan->Seg[c->SegIdx].Frames;
+			c->Step		= plan->Seg[c->SegIdx].Step;
+			c->SegIdx++;
+		
+		}//end if
+		else{
+		
+			//Arrived, land on the target and tell the main loop,
+			//	unless the command was replaced
+			c->Pos			= (uint32_t)c->PlanTarget[c->PlanRun]<<MOTION_PLAN_SHIFT;
+			c->Step			= 0;
+			c->Moving		= FALSE;
+			if( c->PlanLive[c->PlanRun] ){
+				c->PlanLive[c->PlanRun]	= FALSE;
+				c->Arrived				= TRUE;
+				c->ArrivedDuty			= c->PlanTarget[c->PlanRun];
+				if( MotionService )
+					MotionService();
+			}//end if
+			
+			if( c->PlanPark[c->PlanRun] ){
+			
+				//Parked, off right away and not held
+				c->HumCount		= 0;
+				c->HoldCount	= 0;
+				SetPWMDuty(ch, c->Pos>>(MOTION_PLAN_SHIFT - TOC1_CNT_SHIFT));
+				SetPWMOutput(ch, FALSE);
+				return;
+			
+			}//end if
+			
+			//Start timing the hum
+			c->HumCount		= c->PlanHum[c->PlanRun];
+			c->HoldCount	= 0;
+		
+		}//end else
+	
+	}//end if
+	
+	if( c->SegLeft ){
+		c->Pos += c->Step;
+		c->SegLeft--;
+	}//end if
+	
+	//Write Value to Servo in TOC1 counts, takes effect next frame
+	SetPWMDuty(ch, c->Pos>>(MOTION_PLAN_SHIFT - TOC1_CNT_SHIFT));
+	
+	if( !GetPWMOutput(ch) )
+		SetPWMOutput(ch, TRUE);
+
+}//end motionFrameCh
+
+void motionFrame(void){
+/*	Desc:		Moves every channel one frame along its plan.
+*	Args:		None.
+*	Ret:		None.
+*	PreReq:		Must be called from the TOC1 overflow ISR.
+*	Side E:		Duty and PWM output may change.
+*/
+
+	//Local variables
+	uint8_t		ch;
+	
+	for( ch = 0; ch < PWM_CH_NUM; ch++ )
+		motionFrameCh(&MotionCh[ch], ch);
+	
+	MotionFrameCnt++;
+
+}//end motionFrame
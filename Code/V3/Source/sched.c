@@ -0,0 +1,169 @@
+/*	File:	sched.c
+*	Desc:	This file contains the cooperative task
+*			scheduler for the main loop.
+*	Proj:	AutoMotion
+*
+*	NOTES:
+*
+*		Tasks are kept in a table owned by the caller, in priority order,
+*	task 0 first.  A task is made ready by its period running out in the
+*	TOC2 tick, or by schedReady() from an ISR or another task.  schedRun()
+*	always runs the first ready task in the table to completion and then
+*	looks again from the top, so a task waits at most for the one task
+*	already running plus the ready tasks ahead of it.
+*
+*		When no task is ready the idle function is called, then the CPU
+*	is put in idle sleep until the next interrupt.  The ready flags are
+*	checked with interrupts off and sei is followed directly by sleep, so
+*	a task made ready in between still wakes the CPU right away.
+*
+*		Each task keeps a count of runs and its total run time, measured
+*	with timerGetUs(), for working out its share of the CPU.
+*/
+
+#include "includes.h"
+
+//Task table
+static SCHED_TASK	*SchedTask;
+static uint8_t		SchedNum;
+//Called before sleeping
+static void			(*SchedIdle)(void);
+
+static uint8_t schedNext(void){
+/*	Desc:		Finds the highest priority ready task.
+*	Args:		None.
+*	Ret:		Task index, SchedNum if none are ready.
+*/
+
+	//Local variables
+	uint8_t		i;
+	
+	for( i = 0; i < SchedNum && !SchedTask[i].Ready; i++ );
+	
+	return( i );
+
+}//end schedNext
+
+void schedInit(SCHED_TASK *tasks, uint8_t num, void (*idle)(void)){
+/*	Desc:		Sets up the task table.
+*	Args:		tasks, table in priority order with Func and Period set.
+*				num, number of tasks.
+*				idle, called when no task is ready, may be NULL.
+*	Ret:		None.
+*	PreReq:		Must be called before the TOC2 interrupt is enabled.
+*	Side E:		Periodic tasks are first made ready after one period.
+*/
+
+	//Local variables
+	uint8_t		i;
+	
+	SchedTask	= tasks;
+	SchedNum	= num;
+	SchedIdle	= idle;
+	
+	for( i = 0; i < num; i++ ){
+	
+		tasks[i].Countdown	= tasks[i].Period;
+		tasks[i].Ready		= FALSE;
+		tasks[i].Runs		= 0;
+		tasks[i].BusyUs		= 0;
+	
+	}//end for
+
+}//end schedInit
+
+void schedReady(uint8_t task){
+/*	Desc:		Makes a task ready.
+*	Args:		task, index in the task table.
+*	Ret:		None.
+*	Notes:		Safe from ISRs.
+*/
+
+	SchedTask[task].Ready = TRUE;
+
+}//end schedReady
+
+uint16_t schedTick(uint8_t elapsed){
+/*	Desc:		Counts down the task periods and makes due tasks ready.
+*	Args:		elapsed, ms since the last call.
+*	Ret:		ms until the next periodic task is due, SCHED_NEVER
+*				if there are none.
+*	PreReq:		Must be called from the TOC2 ISR.
+*/
+
+	//Local variables
+	uint8_t		i;
+	uint16_t	next = SCHED_NEVER;
+	SCHED_TASK	*task;
+	
+	for( i = 0; i < SchedNum; i++ ){
+	
+		task = &SchedTask[i];
+		
+		if( !task->Period )
+			continue;
+		
+		if( task->Countdown <= elapsed ){
+			task->Ready		= TRUE;
+			task->Countdown	= task->Period;
+		}//end if
+		else
+			task->Countdown -= elapsed;
+		
+		if( task->Countdown < next )
+			next = task->Countdown;
+	
+	}//end for
+	
+	return( next );
+
+}//end schedTick
+
+void schedRun(void){
+/*	Desc:		Runs ready tasks forever, sleeping when there are none.
+*	Args:		None.
+*	Ret:		Never returns.
+*	PreReq:		schedInit() must have been called, interrupts on.
+*	Side E:		CPU sleeps between tasks.
+*/
+
+	//Local variables
+	uint8_t		i;
+	uint32_t	start;
+	SCHED_TASK	*task;
+	
+	for(;;){
+	
+		i = schedNext();
+		
+		if( i == SchedNum ){
+		
+			if( SchedIdle )
+				SchedIdle();
+			
+			//Sleep unless something was made ready meanwhile
+			INTR_OFF;
+			if( schedNext() == SchedNum ){
+			
+				set_sleep_mode(SLEEP_MODE_IDLE);
+				MCUCR |= (1<<SE);
+				__asm__ __volatile__ ( "sei" "\n\t" "sleep" "\n\t" :: );
+				MCUCR &= ~(1<<SE);
+			
+			}//end if
+			INTR_ON;
+			continue;
+		
+		}//end if
+		
+		task		= &SchedTask[i];
+		task->Ready	= FALSE;
+		
+		start		= timerGetUs();
+		task->Func();
+		task->BusyUs += timerGetUs() - start;
+		task->Runs++;
+	
+	}//end for
+
+}//end schedRun
@@ -0,0 +1,205 @@
+/*	File:	swtimer.c
+*	Desc:	This file contains the software timer
+*			service used for all main loop timeouts.
+*	Proj:	AutoMotion
+*
+*	NOTES:
+*
+*		Timers are kept in a two level timer wheel.  Level 0 has one slot
+*	per wheel tick (16 ms) and covers the next 256 ms; level 1 has one slot
+*	per 256 ms and covers the next 4 s.  Each slot is a linked list, and
+*	each timer keeps a pointer to the link that points at it, so start and
+*	stop are O(1) and need no search.
+*
+*		swtimerService() runs from the main loop.  It does nothing until
+*	MS_TIMER crosses into a new wheel tick; then it moves the matching
+*	level 1 slot down to level 0 every 16 ticks and calls the function of
+*	every timer in the level 0 slot.  A timer moving down that expires on
+*	that same tick goes straight into the slot about to be expired.  The work per tick is the number of
+*	timers expiring or moving down, not the number of timers running.
+*	Timers longer than level 1 covers are parked in its last slot and
+*	placed again each time it moves down.
+*
+*		Expiry functions run in main loop context and may start or stop
+*	any timer, including the one that expired.
+*/
+
+#include "includes.h"
+
+//Wheel levels, lists of timers
+static SWTIMER			*SwtimerWheel0[SWTIMER_SLOTS];
+static SWTIMER			*SwtimerWheel1[SWTIMER_SLOTS];
+//Last wheel tick that was processed
+static uint32_t			SwtimerTick;
+
+static void swtimerLink(SWTIMER **head, SWTIMER *timer){
+/*	Desc:		Puts a timer at the head of a slot list.
+*	Args:		head, slot list.
+*				timer, timer to add.
+*	Ret:		None.
+*/
+
+	timer->Next		= *head;
+	timer->Pprev	= head;
+	if( *head )
+		(*head)->Pprev = &timer->Next;
+	*head			= timer;
+
+}//end swtimerLink
+
+static void swtimerUnlink(SWTIMER *timer){
+/*	Desc:		Takes a timer out of whatever slot list it is in.
+*	Args:		timer, running timer.
+*	Ret:		None.
+*/
+
+	*timer->Pprev = timer->Next;
+	if( timer->Next )
+		timer->Next->Pprev = timer->Pprev;
+	timer->Pprev = NULL;
+
+}//end swtimerUnlink
+
+static void swtimerPlace(SWTIMER *timer){
+/*	Desc:		Puts a timer in the slot for its expiry tick.
+*	Args:		timer, timer that is not in any list.
+*	Ret:		None.
+*	Notes:		A timer that is already due goes in the next slot.
+*/
+
+	//Local variables
+	uint32_t	expire = timer->Expire;
+	
+	if( (int32_t)(expire - SwtimerTick) <= 0 )
+		expire = SwtimerTick + 1;
+	
+	if( expire - SwtimerTick < SWTIMER_SLOTS ){
+	
+		swtimerLink(&SwtimerWheel0[expire & (SWTIMER_SLOTS - 1)], timer);
+	
+	}//end if
+	else if( (expire >> SWTIMER_SLOT_SHIFT) - (SwtimerTick >> SWTIMER_SLOT_SHIFT) < SWTIMER_SLOTS ){
+	
+		swtimerLink(&SwtimerWheel1[(expire >> SWTIMER_SLOT_SHIFT) & (SWTIMER_SLOTS - 1)], timer);
+	
+	}//end else if
+	else{
+	
+		//Too far out, park in the last level 1 slot
+		swtimerLink(&SwtimerWheel1[((SwtimerTick >> SWTIMER_SLOT_SHIFT) - 1) & (SWTIMER_SLOTS - 1)], timer);
+	
+	}//end else
+
+}//end swtimerPlace
+
+void swtimerInit(void){
+/*	Desc:		Empties the wheel and starts it at the current time.
+*	Args:		None.
+*	Ret:		None.
+*	Notes:		Any running timers are forgotten, not stopped.
+*/
+
+	//Local variables
+	uint8_t		i;
+	
+	for( i = 0; i < SWTIMER_SLOTS; i++ ){
+		SwtimerWheel0[i] = NULL;
+		SwtimerWheel1[i] = NULL;
+	}//end for
+	
+	SwtimerTick = timerGetMs() >> SWTIMER_SHIFT;
+
+}//end swtimerInit
+
+void swtimerStart(SWTIMER *timer, uint32_t ms, SWTIMER_FUNC func, void *arg){
+/*	Desc:		Starts or restarts a timer.
+*	Args:		timer, timer to start.
+*				ms, time until it expires.
+*				func, called with arg when it expires.
+*				arg, passed to func.
+*	Ret:		None.
+*	Notes:		Expires up to one wheel tick late, never early.
+*/
+
+	if( timer->Pprev )
+		swtimerUnlink(timer);
+	
+	timer->Expire	= (timerGetMs() + ms + (1<<SWTIMER_SHIFT) - 1) >> SWTIMER_SHIFT;
+	timer->Func		= func;
+	timer->Arg		= arg;
+	
+	swtimerPlace(timer);
+
+}//end swtimerStart
+
+void swtimerStop(SWTIMER *timer){
+/*	Desc:		Stops a timer without calling its function.
+*	Args:		timer, timer to stop; may already be stopped.
+*	Ret:		None.
+*/
+
+	if( timer->Pprev )
+		swtimerUnlink(timer);
+
+}//end swtimerStop
+
+bool swtimerRunning(const SWTIMER *timer){
+/*	Desc:		Checks if a timer is running.
+*	Args:		timer, timer to check.
+*	Ret:		TRUE if it has been started and has not expired or
+*				been stopped.
+*/
+
+	return ( timer->Pprev != NULL );
+
+}//end swtimerRunning
+
+void swtimerService(void){
+/*	Desc:		Processes every wheel tick up to the current time.
+*	Args:		None.
+*	Ret:		None.
+*	PreReq:		Must be called from the main loop.
+*	Side E:		Expiry functions are called.
+*/
+
+	//Local variables
+	uint32_t	now;
+	SWTIMER		*timer;
+	SWTIMER		**slot;
+	
+	now = timerGetMs() >> SWTIMER_SHIFT;
+	
+	while( SwtimerTick != now ){
+	
+		SwtimerTick++;
+		
+		//Move the next level 1 slot down
+		if( !(SwtimerTick & (SWTIMER_SLOTS - 1)) ){
+		
+			slot = &SwtimerWheel1[(SwtimerTick >> SWTIMER_SLOT_SHIFT) & (SWTIMER_SLOTS - 1)];
+			
+			while( (timer = *slot) != NULL ){
+			
+				swtimerUnlink(timer);
+				
+				//Due on this tick, it goes in the slot expired below
+				if( (int32_t)(timer->Expire - SwtimerTick) <= 0 )
+					swtimerLink(&SwtimerWheel0[SwtimerTick & (SWTIMER_SLOTS - 1)], timer);
+				else
+					swtimerPlace(timer);
+			
+			}//end while
+		
+		}//end if
+		
+		//Expire this tick's slot
+		slot = &SwtimerWheel0[SwtimerTick & (SWTIMER_SLOTS - 1)];
+		
+		while( (timer = *slot) != NULL ){
+			swtimerUnlink(timer);
+			timer->Func(timer->Arg);
+		}//end while
+	
+	}//end while
+
+}//end swtimerService
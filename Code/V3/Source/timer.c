@@ -15,6 +15,16 @@
 
 #include "includes.h"
 
+//32 bit ms counter
+volatile uint32_t	MS_TIMER;
+//Length of the tick that is running, in ms
+static uint8_t		TimerTickMs;
+//How far the compare that ends it is past the ms, x 1 us, with the
+//	time TOC2 was halted added
+static int16_t		TimerTickLate;
+//us time at the start of the current TOC1 frame
+static volatile uint32_t	TimerFrameUs;
+
 void timerInit(void){
 /* Desc:	This function initializes the output
 *			compare 1 A.  It is set to:
@@ -34,31 +44,188 @@ void timerInit(void){
 
 	
 	/* Set timer 1 prescale to fclk/8 = 
-	*	8.0MHz / 8 = 1.0 Mhz count freq.
+	*	8.0MHz / 8 = 1.0 Mhz count freq., or fclk/1
+	*	for PWM_HIRES.
 	*  Set to mode 14 */
 	TCCR1A = 0x82;
-	TCCR1B = 0x1A;
+#if PWM_CH_NUM > 1
+	TCCR1A |= ( 1<<COM1B1 );
+#endif
+	TCCR1B = ( 1<<WGM13 | 1<<WGM12 | TOC1_CS );
 	
-	/* Load top into ICR1A, 20000 counts */
+	/* Load top into ICR1A, 20000 counts, 64000 for PWM_HIRES */
 	ICR1H = TOC1_TOP_VAL >> 8;
 	ICR1L = TOC1_TOP_VAL & 0x00FF;
 	
-	/* Set to 1500 count high time */
-	OCR1AH = PWM_DTY_DFLT>>8;
-	OCR1AL = PWM_DTY_DFLT&0x00FF;
+	/* Set to 1500 us high time */
+	OCR1AH = PWM_US(PWM_DTY_DFLT)>>8;
+	OCR1AL = PWM_US(PWM_DTY_DFLT)&0x00FF;
+	OCR1BH = PWM_US(PWM_DTY_DFLT)>>8;
+	OCR1BL = PWM_US(PWM_DTY_DFLT)&0x00FF;
 	
 /////////////////////////////////////////////////
-//	1 ms timer w/ TOC2
+//	Variable length tick w/ TOC2
 ////////////////////////////////////////////////
 
-	//Set TOC2 to mode 2 (CTC), F_OSC/64 count
-	TCCR2 |= ( 1<<WGM21 | 1<<CS22 );
-	
-	//Load OCR2 with the desired TOP value.
-	OCR2 = 127;
+	//Set TOC2 to normal mode at F_OSC/1024, first tick 1 ms from now
+	TCCR2			= TOC2_CS;
+	OCR2			= TCNT2;
+	TimerTickLate	= 0;
+	timerSetNextTick(1);
 	
 	//Enable compare match interrupt for TOC2
 	TIMSK |= ( 1<<OCIE2 );
+	
+	//Enable overflow interrupt for TOC1 to count frames
+	TIMSK |= ( 1<<TOIE1 );
 
 
 } /* end initOC1B */
+
+uint32_t timerGetMs(void){
+/* Desc:	Returns the ms counter without turning
+*			interrupts off.
+*
+*			The counter is read until two reads in a row
+*			match.  The tick always changes the low byte,
+*			so a read torn by the tick never matches the
+*			read after it.  Each retry costs one more read,
+*			and a retry can only happen once per tick.
+*/
+
+	//Local variables
+	uint32_t	temp;
+	
+	do{
+		temp = MS_TIMER;
+	}while( temp != MS_TIMER );
+	
+	return temp;
+
+} /* end timerGetMs */
+
+uint32_t timerGetUs(void){
+/* Desc:	Returns a us time made from the count of
+*			TOC1 frames and TCNT1.
+*
+*			If the frame has ended but the overflow
+*			ISR hasn't run yet, TOV1 is still set and
+*			TCNT1 has wrapped, so the frame is added
+*			here.  TCNT1 is read before TIFR so a
+*			wrap between the two reads can't be
+*			counted twice.  Safe to call from ISRs.
+*
+*			TOC1 halts during a2d sleep conversions,
+*			so the time stands still for those until
+*			timerAddHalt() adds them back.  With
+*			PWM_HIRES the counts are shifted down to us.
+*/
+
+	//Local variables
+	uint8_t		sreg;
+	uint16_t	count;
+	uint32_t	temp;
+	
+	//The 16 bit reads share TEMP with the ISRs
+	sreg	= SREG;
+	INTR_OFF;
+	
+	temp	= TimerFrameUs;
+	count	= TCNT1;
+	
+	if( (TIFR & (1<<TOV1)) && count < (ICR1>>1) )
+		temp += (ICR1 + 1)>>TOC1_CNT_SHIFT;
+	
+	SREG	= sreg;
+	
+	return temp + (count>>TOC1_CNT_SHIFT);
+
+} /* end timerGetUs */
+
+uint8_t timerTickElapsed(void){
+/* Desc:	Adds the tick that just ended to the
+*			ms counter.
+*
+*			Must be called once at the start of the
+*			TOC2 compare ISR.  Returns the length of
+*			the tick in ms, so the ISR can run its
+*			countdowns by the right amount.
+*/
+
+	MS_TIMER += TimerTickMs;
+	
+	return TimerTickMs;
+
+} /* end timerTickElapsed */
+
+void timerSetNextTick(uint16_t ms){
+/* Desc:	Sets the length of the next tick to ms,
+*			at most TICK_MAX_MS.
+*
+*			The tick only runs as often as the nearest
+*			deadline needs it, so a parked cover takes
+*			a few interrupts per sample period instead
+*			of one every ms.  TCNT2 runs free and the
+*			next compare is set from the last one, not
+*			from when the ISR got to it, and the
+*			prescaler is never changed or restarted, so
+*			no count is lost between ticks.  A count is
+*			128 us, so the compare is the first one at
+*			or past the ms and TimerTickLate carries the
+*			difference into the next tick.  A tick that
+*			is owed more than it lasts is one count
+*			long.  Must be called from the TOC2 compare
+*			ISR, under a tick after the match.
+*/
+
+	//Local variables
+	int16_t		us;
+	uint8_t		counts;
+	
+	if( !ms )
+		ms = 1;
+	else if( ms > TICK_MAX_MS )
+		ms = TICK_MAX_MS;
+	
+	us		= (int16_t)( ms * 1000U ) - TimerTickLate;
+	counts	= ( us > TOC2_CNT_US ) ? ( us + TOC2_CNT_US - 1 ) / TOC2_CNT_US : 1;
+	
+	TimerTickMs		= ms;
+	TimerTickLate	= counts * TOC2_CNT_US - us;
+	OCR2			+= counts;
+
+} /* end timerSetNextTick */
+
+void timerAddHalt(uint16_t us){
+/* Desc:	Adds a time TOC1 and TOC2 were halted, by an
+*			a2d conversion in ADC noise reduction sleep,
+*			to the us time and the ms counter.
+*
+*			The us time gets it right away.  The tick
+*			that is running ends that much later than
+*			it should, so the next one is made shorter
+*			by it and MS_TIMER catches up at its end.
+*			Must be called with interrupts off.
+*/
+
+	TimerFrameUs	+= us;
+	TimerTickLate	+= us;
+
+} /* end timerAddHalt */
+
+//Interrupt service routine for TOC1 overflow
+SIGNAL(SIG_OVERFLOW1){
+/* Desc:	Runs at TOP, once per PWM frame, and starts
+*			the software PWM pulses, then adds the frame
+*			that just ended to the us time.  Then steps
+*			the motion engine, whose duty write is
+*			latched at the next TOP.
+*/
+
+	PWMFrameStart();
+	
+	TimerFrameUs += (ICR1 + 1)>>TOC1_CNT_SHIFT;
+	
+	motionFrame();
+
+} /* end SIG_OVERFLOW1 */
@@ -0,0 +1,6 @@
+/*	File:	inttypes.h
+*	Desc:	Only used by int16.py.
+*	Proj:	AutoMotion
+*/
+
+#include <stdint.h>
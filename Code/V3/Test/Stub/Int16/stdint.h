@@ -0,0 +1,17 @@
+/*	File:	stdint.h
+*	Desc:	The avr-libc integer types for the atmega8, where int
+*			is 16 bits.  Only used by int16.py.
+*	Proj:	AutoMotion
+*/
+
+#ifndef STUB_STDINT_H
+#define STUB_STDINT_H
+
+typedef signed char		int8_t;
+typedef unsigned char	uint8_t;
+typedef int				int16_t;
+typedef unsigned int	uint16_t;
+typedef long			int32_t;
+typedef unsigned long	uint32_t;
+
+#endif /* #ifndef STUB_STDINT_H */
@@ -0,0 +1,15 @@
+/*	File:	stdlib.h
+*	Desc:	The parts of avr-libc stdlib.h the tree uses.  Only
+*			used by int16.py.
+*	Proj:	AutoMotion
+*/
+
+#ifndef STUB_STDLIB_H
+#define STUB_STDLIB_H
+
+#define NULL	((void *)0)
+
+int		abs		(int x);
+long	labs	(long x);
+
+#endif /* #ifndef STUB_STDLIB_H */
@@ -0,0 +1,4 @@
+/*	File:	eeprom.h
+*	Desc:	Host stand in, nothing in the tree uses the eeprom yet.
+*	Proj:	AutoMotion
+*/
@@ -0,0 +1,14 @@
+/*	File:	interrupt.h
+*	Desc:	Host stand in, the global interrupt flag is SREG bit 7.
+*			A model that runs interrupts when they are turned back
+*			on defines STUB_SEI_FUNC and supplies stubSei().
+*	Proj:	AutoMotion
+*/
+
+#ifdef STUB_SEI_FUNC
+void	stubSei		(void);
+#define sei()		stubSei()
+#else
+#define sei()		(SREG |= 0x80)
+#endif
+#define cli()		(SREG &= ~0x80)
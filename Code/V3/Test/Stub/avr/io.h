@@ -0,0 +1,74 @@
+/*	File:	io.h
+*	Desc:	Host stand in for the avr-libc atmega8 register file.
+*			Registers are plain variables, defined in regs.c.
+*	Proj:	AutoMotion
+*/
+
+#ifndef STUB_IO_H
+#define STUB_IO_H
+
+#include <stdint.h>
+
+#ifndef STUB_REG
+#define STUB_REG	extern
+#endif
+
+#define R8(n)		STUB_REG volatile uint8_t n
+#define R16(n)		STUB_REG volatile uint16_t n
+
+R8(ADMUX);
+R8(TCCR1A); R8(TCCR1B); R16(ICR1); R16(OCR1A); R16(OCR1B);
+R8(TIMSK); R8(TIFR); R8(TCCR2); R8(OCR2); R8(TCNT2); R8(TCCR0); R8(TCNT0); R8(ASSR); R8(SFIOR);
+R8(DDRB); R8(PORTB); R8(PINB); R8(DDRC); R8(PORTC); R8(PINC); R8(DDRD); R8(PORTD); R8(PIND);
+R8(MCUCR); R8(SREG);
+
+//Byte halves of the 16 bit registers, little endian host
+#define STUB_LO(r)	(((volatile uint8_t *)&(r))[0])
+#define STUB_HI(r)	(((volatile uint8_t *)&(r))[1])
+#define ADC			ADCW
+#define ADCL		STUB_LO(ADCW)
+#define ADCH		STUB_HI(ADCW)
+#define ICR1L		STUB_LO(ICR1)
+#define ICR1H		STUB_HI(ICR1)
+#define OCR1AL		STUB_LO(OCR1A)
+#define OCR1AH		STUB_HI(OCR1A)
+#define OCR1BL		STUB_LO(OCR1B)
+#define OCR1BH		STUB_HI(OCR1B)
+
+//A model that runs the a2d supplies ADCSRA and the result register as
+//	functions, called for every access
+#ifdef STUB_ADC_FUNC
+volatile uint8_t	*stubAdcsra	(void);
+volatile uint16_t	*stubAdcw	(void);
+#define ADCSRA		(*stubAdcsra())
+#define ADCW		(*stubAdcw())
+#else
+R8(ADCSRA); R16(ADCW);
+#endif
+
+//A model that runs TOC1 supplies the count as a function
+#ifdef STUB_TCNT1_FUNC
+uint16_t	stubTcnt1	(void);
+#define TCNT1		stubTcnt1()
+#else
+R16(TCNT1);
+#endif
+
+enum{ ADEN = 7, ADSC = 6, ADFR = 5, ADIF = 4, ADIE = 3, ADPS2 = 2, ADPS1 = 1, ADPS0 = 0 };
+enum{ REFS1 = 7, REFS0 = 6, ADLAR = 5, MUX3 = 3, MUX2 = 2, MUX1 = 1, MUX0 = 0 };
+enum{ OCIE2 = 7, TOIE2 = 6, TICIE1 = 5, OCIE1A = 4, OCIE1B = 3, TOIE1 = 2, TOIE0 = 0 };
+enum{ OCF2 = 7, TOV2 = 6, ICF1 = 5, OCF1A = 4, OCF1B = 3, TOV1 = 2, TOV0 = 0 };
+enum{ FOC2 = 7, WGM20 = 6, COM21 = 5, COM20 = 4, WGM21 = 3, CS22 = 2, CS21 = 1, CS20 = 0 };
+enum{ COM1A1 = 7, COM1A0 = 6, COM1B1 = 5, COM1B0 = 4, WGM11 = 1, WGM10 = 0 };
+enum{ ICNC1 = 7, ICES1 = 6, WGM13 = 4, WGM12 = 3, CS12 = 2, CS11 = 1, CS10 = 0 };
+enum{ CS02 = 2, CS01 = 1, CS00 = 0 };
+enum{ SE = 7, SM2 = 6, SM1 = 5, SM0 = 4 };
+enum{ PSR2 = 1, PSR10 = 0 };
+enum{ PB0, PB1, PB2, PB3, PB4, PB5, PB6, PB7 };
+enum{ PC0, PC1, PC2, PC3, PC4, PC5, PC6 };
+enum{ PD0, PD1, PD2, PD3, PD4, PD5, PD6, PD7 };
+
+#define sbi(p, b)	((p) |= (1<<(b)))
+#define cbi(p, b)	((p) &= ~(1<<(b)))
+
+#endif /* #ifndef STUB_IO_H */
@@ -0,0 +1,10 @@
+/*	File:	pgmspace.h
+*	Desc:	Host stand in, flash tables are ordinary constants.
+*	Proj:	AutoMotion
+*/
+
+#include <stdint.h>
+
+#define PROGMEM
+#define pgm_read_byte(a)	(*(const uint8_t *)(a))
+#define pgm_read_word(a)	(*(const uint16_t *)(a))
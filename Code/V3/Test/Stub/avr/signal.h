@@ -0,0 +1,8 @@
+/*	File:	signal.h
+*	Desc:	Host stand in, interrupt handlers are plain functions
+*			the model calls.
+*	Proj:	AutoMotion
+*/
+
+#define SIGNAL(v)		void v(void); void v(void)
+#define INTERRUPT(v)	void v(void); void v(void)
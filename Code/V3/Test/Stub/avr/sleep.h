@@ -0,0 +1,22 @@
+/*	File:	sleep.h
+*	Desc:	Host stand in.  A model that sleeps supplies
+*			stubSleep(), called for every sleep_mode() and
+*			sleep_cpu().
+*	Proj:	AutoMotion
+*/
+
+#define SLEEP_MODE_IDLE		0
+#define SLEEP_MODE_ADC		1
+
+#define set_sleep_mode(m)	(MCUCR = (MCUCR & ~(1<<SM2 | 1<<SM1 | 1<<SM0)) | ((m)<<SM0))
+
+#define sleep_enable()		(MCUCR |= (1<<SE))
+#define sleep_disable()		(MCUCR &= ~(1<<SE))
+
+#ifdef STUB_SLEEP_FUNC
+void	stubSleep	(void);
+#define sleep_cpu()			stubSleep()
+#else
+#define sleep_cpu()			((void)0)
+#endif
+#define sleep_mode()		do{ sleep_enable(); sleep_cpu(); sleep_disable(); }while(0)
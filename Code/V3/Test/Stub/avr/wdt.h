@@ -0,0 +1,8 @@
+/*	File:	wdt.h
+*	Desc:	Host stand in.
+*	Proj:	AutoMotion
+*/
+
+#define WDTO_500MS			5
+#define wdt_enable(x)		((void)(x))
+#define wdt_reset()			((void)0)
@@ -0,0 +1,7 @@
+/*	File:	regs.c
+*	Desc:	Defines the registers declared by the stand in avr/io.h.
+*	Proj:	AutoMotion
+*/
+
+#define STUB_REG
+#include <avr/io.h>
@@ -0,0 +1,731 @@
+/*	File:	a2dbench.c
+*	Desc:	Host benchmark of the a2d scan in a2d.c against a model
+*			of the atmega8 a2d.
+*	Proj:	AutoMotion
+*
+*	NOTES:
+*
+*		The model counts CPU clocks.  ADCSRA and the result register are
+*	functions, so every access is seen; a write is found at the next
+*	access by comparing ADCSRA with what the model last left in it.
+*	Setting ADSC starts a conversion on the next a2d clock, 13 a2d clocks
+*	long, 25 for the first after ADEN, at the prescaler in ADPS2:0.  A
+*	write with ADIF set clears it, as a read-modify-write does on the
+*	part.  The result is the channel on the mux at the start, in the
+*	ADLAR format of the time it is read.  SIG_ADC runs when ADIF, ADIE
+*	and the I flag are all set.  Each ADCSRA access costs BENCH_ACCESS
+*	clocks; the ISRs take no time of their own.
+*
+*		The main loop is schedRun(): every pass runs the input task if it
+*	is ready, calls a2dSleepService() and then idle sleeps to the next
+*	interrupt, the TOC2 tick, the TOC1 frame or SIG_ADC, in vector order.
+*	The tick runs the timer.c and a2dTick() calls the TOC2 ISR in main.c
+*	does, with the input task every BENCH_TASK_MS, and TCNT2 counts
+*	clkIO / 1024 to OCR2.  The input task reads the switch and the three
+*	pots.  The frame sets TOV1 and runs SIG_OVERFLOW1 from timer.c.  ADC
+*	noise reduction sleep starts a conversion if none is running, and
+*	halts TOC1 and TOC2 until it completes.  The servo pulse is
+*	BENCH_PULSE long.  There is no simulator for the part, so only the
+*	time spent waiting on the a2d is measured, not the code.
+*
+*		scan: 10 s with the pins held still.  It reports the results per
+*	second of each channel, the SIG_ADC runs per second, and the time the
+*	CPU polls a running conversion.  It fails if anything after a2dInit()
+*	polls, a channel gets less than 90% of one result every period, or a
+*	read isn't its pin on the 12 bit scale.
+*
+*		sleep: 10 s with the pins held still.  It reports the conversion
+*	time per second with clkIO running, when the servo pins and timers
+*	add noise, and with it halted in noise reduction sleep, the SIG_ADC
+*	runs per result of each channel, and how much the sleeps stretch the
+*	frame.  At each tick it takes how far MS_TIMER and timerGetUs() are
+*	behind the CPU clock, and reports the range and the drift from the
+*	first tick to the last.  A sleep puts back 13.5 a2d clocks, but the
+*	edge the conversion starts on is anywhere in the clock, so each
+*	sleep can be up to half a clock off, 4 us at F_OSC/64.  It fails if
+*	a sleep starts while a pulse is high, no conversion is made asleep,
+*	or either time drifts by that much for every sleep.
+*
+*		settle: the same for input time constants of 1, 4 and 16 us.  A
+*	mux change takes the a2d input from where it was toward the new pin
+*	with that time constant, and the sample is taken 1.5 a2d clocks into
+*	the conversion, 13.5 for the first.  The part wants sources under
+*	10 kohm, 0.14 us with its 14 pF sample cap, so the time constants
+*	stand in for pots with a higher wiper resistance.  It reports the
+*	worst published error of each channel against its pin, the results
+*	and discarded conversions per second.  It fails if a channel that
+*	discards is off by more than a 10 bit count at 4 us.
+*
+*		profile: 10 s with every pin ramping through full scale and
+*	gaussian noise on each conversion, BENCH_NOISE_PRECISE rms at an a2d
+*	clock up to 200 kHz and BENCH_NOISE_FAST above it, where the part
+*	gives up accuracy.  The noise levels are assumed, there is no part to
+*	measure.  It reports each channel's a2d clock and conversion time,
+*	and the rms and worst error of its results against the pin over the
+*	conversions that made them.  It fails if the switch is off by more
+*	than 1% of full scale or a pot by more than BENCH_POT_ERR.
+*/
+
+#define STUB_ADC_FUNC
+#define STUB_TCNT1_FUNC
+#define STUB_SLEEP_FUNC
+
+#include <stdio.h>
+#include <math.h>
+#include "includes.h"
+
+#define BENCH_CLK_US	8
+#define BENCH_CLK_CNT	( BENCH_CLK_US>>TOC1_CNT_SHIFT )
+#define BENCH_FRAME		( (int64_t)( TOC1_TOP_VAL + 1 ) * BENCH_CLK_CNT )
+#define BENCH_ACCESS	3		//in, sbrc, rjmp of a polling loop
+#define BENCH_TASK_MS	A2D_SWITCH_PERIOD	//SAMPLE_DIV in main.c
+#define BENCH_TOC2_CLK	1024	//CPU clocks per TCNT2 count
+#define BENCH_PULSE		PWM_US(2250)
+#define BENCH_NOISE_PRECISE	0.5		//10 bit counts rms
+#define BENCH_NOISE_FAST	1.0
+#define BENCH_POT_ERR		12		//12 bit counts
+#define BENCH_DRIFT_SLEEP	4		//us a sleep's time can be off
+
+static int64_t		BenchClk;			//now, CPU clocks
+static int64_t		BenchHalt;			//clocks clkIO was halted
+static uint8_t		BenchAdcsra;		//ADCSRA as the code sees it
+static uint8_t		BenchAdcsraLeft;	//ADCSRA as the model last left it
+static uint16_t		BenchAdcw;
+static uint16_t		BenchResult;		//10 bits
+static int64_t		BenchConvEnd = -1;	//running conversion completes, -1 if none
+static bool			BenchAdif;
+static bool			BenchFirst;			//next conversion is the first after ADEN
+static double		BenchInput[8];		//pins, 10 bit counts
+static double		BenchTau;			//a2d input time constant, us, 0 for none
+static uint8_t		BenchMuxCh;			//mux channel
+static int64_t		BenchMuxAt;			//clock the mux was changed
+static double		BenchFrom;			//a2d input at the change
+static double		BenchSlope;			//pin ramp, 10 bit counts per clock
+static bool			BenchNoise;
+static double		BenchTrue;			//pin at the last sample and hold
+static uint32_t		BenchSeed = 1;
+static int64_t		BenchTickAt;		//clkIO clock of the next tick
+static uint16_t		BenchTaskMs;
+static bool			BenchTask;			//InputTask ready in main.c
+static int64_t		BenchFrameAt;		//clkIO clock of the next frame
+static uint16_t		BenchPoll;			//accesses in a row to a running conversion
+static const char	*BenchName[A2D_SCAN_NUM] = { "switch", "speed", "open", "closed" };
+
+//Results
+static int64_t		BenchPollClk;		//polling
+static int64_t		BenchPollOff;		//polling with interrupts off
+static int64_t		BenchPollRun;		//this run of polling with interrupts off
+static int64_t		BenchPollMost;		//longest run of it
+static uint32_t		BenchIsrs;
+static uint32_t		BenchCount[A2D_SCAN_NUM];
+static uint8_t		BenchSeen[A2D_SCAN_NUM];
+static uint32_t		BenchWrong;			//reads that weren't their pin
+static uint32_t		BenchSlotIsrs[A2D_SCAN_NUM];
+static int64_t		BenchConvClk;		//converting
+static int64_t		BenchConvHalt;		//converting with clkIO halted
+static uint32_t		BenchSleeps;
+static uint32_t		BenchSleepHigh;		//sleeps started with a pulse high
+static double		BenchErr[A2D_SCAN_NUM];	//worst published error, 12 bit counts
+static double		BenchErrSq[A2D_SCAN_NUM];
+static double		BenchTrueAcc[A2D_SCAN_NUM];	//pin over the conversions of a result
+static uint8_t		BenchTrueNum[A2D_SCAN_NUM];
+static int64_t		BenchChClk[8];		//conversion clocks, not the first
+static uint32_t		BenchChConvs[8];
+static uint32_t		BenchDiscards;
+static uint32_t		BenchTicks;
+static int64_t		BenchMsErr[3];		//MS_TIMER behind, us: first tick, least, most
+static int64_t		BenchMsLast;
+static int64_t		BenchUsErr[3];		//timerGetUs() behind
+static int64_t		BenchUsLast;
+
+static int64_t benchIo(void){
+/*	Desc:		Clock of TOC1 and TOC2, which stop in noise reduction sleep.
+*	Ret:		clkIO clocks.
+*/
+
+	return BenchClk - BenchHalt;
+
+}//end benchIo
+
+uint16_t stubTcnt1(void){
+
+	return ( benchIo() % BENCH_FRAME ) / BENCH_CLK_CNT;
+
+}//end stubTcnt1
+
+uint16_t GetPWMHighMax(void){
+
+	return BENCH_PULSE;
+
+}//end GetPWMHighMax
+
+void PWMFrameStart(void){
+}//end PWMFrameStart
+
+void motionFrame(void){
+}//end motionFrame
+
+static double benchGauss(void){
+
+	//Local variables
+	double		u;
+	double		v;
+
+	BenchSeed	= BenchSeed * 1103515245UL + 12345;
+	u			= ( (BenchSeed>>8) + 1.0 ) / 16777217.0;
+	BenchSeed	= BenchSeed * 1103515245UL + 12345;
+	v			= ( BenchSeed>>8 ) / 16777216.0;
+
+	return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+
+}//end benchGauss
+
+static double benchPin(uint8_t ch, int64_t clk){
+/*	Desc:		Works out the voltage on a pin.
+*	Args:		ch, mux channel.
+*				clk, CPU clock.
+*	Ret:		10 bit counts.
+*/
+
+	if( !BenchSlope )
+		return BenchInput[ch];
+
+	return fmod(BenchInput[ch] + BenchSlope * clk, 1024);
+
+}//end benchPin
+
+static double benchNode(int64_t clk){
+/*	Desc:		Works out the a2d input, settling after a mux change.
+*	Args:		clk, CPU clock.
+*	Ret:		10 bit counts.
+*/
+
+	if( BenchTau <= 0 )
+		return benchPin(BenchMuxCh, clk);
+
+	return benchPin(BenchMuxCh, clk) + ( BenchFrom - benchPin(BenchMuxCh, clk) )
+		* exp(-( clk - BenchMuxAt ) / ( BenchTau * BENCH_CLK_US ));
+
+}//end benchNode
+
+static void benchStart(void){
+/*	Desc:		Starts a conversion on the next a2d clock.
+*/
+
+	//Local variables
+	static const uint8_t	divs[8] = { 2, 2, 4, 8, 16, 32, 64, 128 };
+	uint8_t		div = divs[BenchAdcsra & 0x07];
+	int64_t		start;
+	int64_t		hold;
+	double		v;
+
+	start			= ( BenchClk + div - 1 ) / div * div;
+	BenchConvEnd	= start + ( BenchFirst ? 25 : 13 ) * div;
+	BenchConvClk	+= BenchConvEnd - BenchClk;
+	if( !BenchFirst ){
+		BenchChClk[BenchMuxCh]		+= 13 * div;
+		BenchChConvs[BenchMuxCh]++;
+	}//end if
+
+	//Sample and hold
+	hold		= start + ( BenchFirst ? 27 : 3 ) * div / 2;
+	v			= benchNode(hold);
+	BenchTrue	= benchPin(BenchMuxCh, hold);
+	BenchFirst	= FALSE;
+	if( BenchNoise )
+		v += ( ( F_OSC / div > 200000 ) ? BENCH_NOISE_FAST : BENCH_NOISE_PRECISE ) * benchGauss();
+	BenchResult = ( v < 0 ) ? 0 : ( v > 1023 ) ? 1023 : (uint16_t)( v + 0.5 );
+
+}//end benchStart
+
+static void benchAdc(void){
+/*	Desc:		Brings the a2d up to BenchClk, taking in the writes since
+*				the model last left ADCSRA.
+*/
+
+	//Local variables
+	uint8_t		reg = BenchAdcsra;
+
+	if( ( ADMUX & 0x07 ) != BenchMuxCh ){
+		BenchFrom	= benchNode(BenchClk);
+		BenchMuxAt	= BenchClk;
+		BenchMuxCh	= ADMUX & 0x07;
+	}//end if
+
+	if( reg != BenchAdcsraLeft ){
+
+		if( ( reg & ~BenchAdcsraLeft ) & ( 1<<ADEN ) )
+			BenchFirst = TRUE;
+		if( reg & ( 1<<ADIF ) )
+			BenchAdif = FALSE;
+		if( ( reg & ( 1<<ADEN ) ) && ( reg & ( 1<<ADSC ) ) && BenchConvEnd < 0 )
+			benchStart();
+
+	}//end if
+
+	if( BenchConvEnd >= 0 && BenchClk >= BenchConvEnd ){
+		BenchConvEnd	= -1;
+		BenchAdif		= TRUE;
+		BenchPoll		= 0;
+	}//end if
+
+	BenchAdcsra = BenchAdcsraLeft = ( reg & ~( 1<<ADSC | 1<<ADIF ) )
+		| ( ( BenchConvEnd >= 0 ) ? 1<<ADSC : 0 ) | ( BenchAdif ? 1<<ADIF : 0 );
+
+}//end benchAdc
+
+volatile uint8_t *stubAdcsra(void){
+
+	benchAdc();
+
+	//Reading a running conversion again is polling it
+	if( BenchConvEnd >= 0 && ++BenchPoll > 1 ){
+
+		BenchPollClk += BENCH_ACCESS;
+		if( !( SREG & 0x80 ) ){
+			BenchPollOff += BENCH_ACCESS;
+			BenchPollRun += BENCH_ACCESS;
+			if( BenchPollRun > BenchPollMost )
+				BenchPollMost = BenchPollRun;
+		}//end if
+
+	}//end if
+	else
+		BenchPollRun = 0;
+	BenchClk += BENCH_ACCESS;
+
+	return &BenchAdcsra;
+
+}//end stubAdcsra
+
+volatile uint16_t *stubAdcw(void){
+
+	benchAdc();
+	BenchAdcw = ( ADMUX & ( 1<<ADLAR ) ) ? BenchResult<<6 : BenchResult;
+
+	return &BenchAdcw;
+
+}//end stubAdcw
+
+static void benchIsr(void);
+
+void stubSleep(void){
+
+	//Local variables
+	int64_t		start;
+
+	benchAdc();
+	if( ( MCUCR & ( 1<<SM2 | 1<<SM1 | 1<<SM0 ) ) != ( SLEEP_MODE_ADC<<SM0 ) )
+		return;
+
+	//Noise reduction sleep starts a conversion, and wakes on its interrupt
+	if( BenchConvEnd < 0 && ( BenchAdcsra & ( 1<<ADEN ) ) )
+		benchStart();
+	if( BenchConvEnd < 0 )
+		return;
+
+	BenchSleeps++;
+	if( TCNT1 <= BENCH_PULSE )
+		BenchSleepHigh++;
+
+	start			= BenchClk;
+	BenchClk		= BenchConvEnd;
+	BenchHalt		+= BenchClk - start;
+	BenchConvHalt	+= BenchClk - start;
+	benchIsr();
+
+}//end stubSleep
+
+#include "../Source/timer.c"
+#include "../Source/a2d.c"
+
+static void benchErr(int64_t err[3], int64_t *last, int64_t now){
+/*	Desc:		Takes how far a time is behind the CPU clock.
+*	Args:		err, first, least and most.
+*				last, gets the newest.
+*				now, how far it is behind, us.
+*/
+
+	if( !BenchTicks )
+		err[0] = err[1] = err[2] = now;
+	if( now < err[1] )
+		err[1] = now;
+	if( now > err[2] )
+		err[2] = now;
+	*last = now;
+
+}//end benchErr
+
+static void benchIsr(void){
+/*	Desc:		Runs the interrupts that are due, in vector order.
+*/
+
+	//Local variables
+	uint8_t		s;
+	uint8_t		count;
+	uint8_t		elapsed;
+	uint8_t		ocr;
+	uint16_t	next;
+	double		err;
+
+	benchAdc();
+
+	//TOC2 tick, as in main.c
+	if( benchIo() >= BenchTickAt ){
+
+		SREG		&= ~0x80;
+		BenchPoll	= 0;
+		elapsed		= timerTickElapsed();
+		next		= a2dTick(elapsed);
+		if( BenchTaskMs <= elapsed ){
+			BenchTask	= TRUE;
+			BenchTaskMs	= BENCH_TASK_MS;
+		}//end if
+		else
+			BenchTaskMs -= elapsed;
+		if( BenchTaskMs < next )
+			next = BenchTaskMs;
+		ocr			= OCR2;
+		timerSetNextTick(next);
+		BenchTickAt	+= (uint8_t)( OCR2 - ocr ) * BENCH_TOC2_CLK;
+		SREG |= 0x80;
+		benchAdc();
+
+		benchErr(BenchMsErr, &BenchMsLast, BenchClk / BENCH_CLK_US - MS_TIMER * 1000LL);
+		benchErr(BenchUsErr, &BenchUsLast, BenchClk / BENCH_CLK_US - timerGetUs());
+		BenchTicks++;
+
+	}//end if
+
+	//TOC1 frame
+	if( benchIo() >= BenchFrameAt ){
+		BenchFrameAt	+= BENCH_FRAME;
+		TIFR			|= 1<<TOV1;
+	}//end if
+	if( ( TIFR & ( 1<<TOV1 ) ) && ( TIMSK & ( 1<<TOIE1 ) ) ){
+		TIFR &= ~( 1<<TOV1 );
+		SREG &= ~0x80;
+		SIG_OVERFLOW1();
+		SREG |= 0x80;
+	}//end if
+
+	if( BenchAdif && ( BenchAdcsra & ( 1<<ADIE ) ) ){
+
+		SREG		&= ~0x80;
+		BenchPoll	= 0;
+		BenchAdif	= FALSE;
+		BenchAdcsra	= BenchAdcsraLeft = BenchAdcsra & ~( 1<<ADIF );
+		s		= A2dSlot;
+		count	= A2dCount[s];
+		BenchSlotIsrs[s]++;
+		if( !A2dSettled && A2dScan[s].Discard )
+			BenchDiscards++;
+		else{
+			BenchTrueAcc[s] += BenchTrue;
+			BenchTrueNum[s]++;
+		}//end else
+		SIG_ADC();
+		SREG		|= 0x80;
+
+		//Result against the pin over its conversions
+		if( count != A2dCount[s] ){
+			err				= A2dRing[s][A2dHead[s]] - 4 * BenchTrueAcc[s] / BenchTrueNum[s];
+			BenchErrSq[s]	+= err * err;
+			if( fabs(err) > BenchErr[s] )
+				BenchErr[s] = fabs(err);
+			BenchTrueAcc[s]	= 0;
+			BenchTrueNum[s]	= 0;
+		}//end if
+		BenchIsrs++;
+		benchAdc();
+
+	}//end if
+
+	for( s = 0; s < A2D_SCAN_NUM; s++ ){
+		BenchCount[s]	+= (uint8_t)( A2dCount[s] - BenchSeen[s] );
+		BenchSeen[s]	= A2dCount[s];
+	}//end for
+
+}//end benchIsr
+
+static void benchTask(void){
+/*	Desc:		The main loop's reads, each checked against its pin
+*				on the 12 bit scale.
+*/
+
+	//Local variables
+	uint8_t		ch;
+	uint8_t		i;
+
+	for( i = 0; i < A2D_SCAN_NUM; i++ ){
+		ch = A2dScan[i].Ch;
+		if( a2dGetSample(ch) != (uint16_t)( BenchInput[ch] + 0.5 )<<A2D_DECIMATE_SHIFT )
+			BenchWrong++;
+	}//end for
+
+}//end benchTask
+
+static void benchRun(uint32_t ms){
+/*	Desc:		Runs the main loop.
+*	Args:		ms, time to run, x 1 ms.
+*/
+
+	//Local variables
+	int64_t		end	= BenchClk + ms * 1000LL * BENCH_CLK_US;
+	int64_t		next;
+
+	while( BenchClk < end ){
+
+		BenchPoll = 0;
+		if( BenchTask ){
+			BenchTask = FALSE;
+			benchTask();
+		}//end if
+		a2dSleepService();
+
+		//Idle sleep to the next interrupt
+		next = ( BenchTickAt < BenchFrameAt ) ? BenchTickAt : BenchFrameAt;
+		next += BenchHalt;
+		if( BenchConvEnd >= 0 && BenchConvEnd < next )
+			next = BenchConvEnd;
+		if( BenchAdif )
+			next = BenchClk;
+		if( next > BenchClk )
+			BenchClk = next;
+		benchIsr();
+
+	}//end while
+
+}//end benchRun
+
+static void benchClear(void){
+
+	//Local variables
+	uint8_t		s;
+
+	BenchPollClk	= BenchPollOff = BenchPollRun = BenchPollMost = 0;
+	BenchIsrs		= 0;
+	BenchWrong		= 0;
+	BenchConvClk	= BenchConvHalt = 0;
+	BenchSleeps		= BenchSleepHigh = 0;
+	BenchDiscards	= 0;
+	BenchTicks		= 0;
+	for( s = 0; s < A2D_SCAN_NUM; s++ ){
+		BenchCount[s]	= BenchSlotIsrs[s] = 0;
+		BenchErr[s]		= BenchErrSq[s] = 0;
+	}//end for
+	for( s = 0; s < 8; s++ ){
+		BenchChClk[s]	= 0;
+		BenchChConvs[s]	= 0;
+	}//end for
+
+}//end benchClear
+
+static void benchInit(void){
+
+	//Local variables
+	uint8_t		s;
+
+	BenchInput[A2D_SWITCH_CH]	= 512;
+	BenchInput[A2D_SPEED_CH]	= 300;
+	BenchInput[A2D_OPEN_CH]		= 700;
+	BenchInput[A2D_CLSD_CH]		= 900;
+
+	SREG = 0;
+	TCNT2 = 0;
+	timerInit();
+	BenchTickAt		= OCR2 * BENCH_TOC2_CLK;
+	BenchTaskMs		= BENCH_TASK_MS;
+	BenchFrameAt	= BENCH_FRAME;
+	OCR1A	= BENCH_PULSE;
+	DDRB	|= 1<<PB1;
+	a2dInit();
+	printf("a2dInit polls %lld us\n", (long long)( BenchPollClk / BENCH_CLK_US ));
+
+	SREG			|= 0x80;
+	for( s = 0; s < A2D_SCAN_NUM; s++ )
+		BenchSeen[s] = A2dCount[s];
+	benchClear();
+
+}//end benchInit
+
+static int benchScan(void){
+/*	Desc:		Runs the scan section.
+*	Ret:		Failures.
+*/
+
+	//Local variables
+	double		s		= 10;
+	double		want;
+	uint8_t		i;
+	int			fail	= 0;
+
+	benchRun(s * 1000);
+
+	printf("\nscan, %.0f s with the pins held still\n  results / s:", s);
+	for( i = 0; i < A2D_SCAN_NUM; i++ ){
+		want = 1000.0 / A2dPeriod[i];
+		printf("  %s %.1f", BenchName[i], BenchCount[i] / s);
+		if( BenchCount[i] / s < 0.9 * want ){
+			printf(" FAIL");
+			fail++;
+		}//end if
+	}//end for
+	printf("\n  SIG_ADC runs / s: %.0f\n", BenchIsrs / s);
+	printf("  polling, us / s: %.1f, %.1f of it with interrupts off, longest %lld us\n",
+		BenchPollClk / s / BENCH_CLK_US, BenchPollOff / s / BENCH_CLK_US,
+		(long long)( BenchPollMost / BENCH_CLK_US ));
+	printf("  reads that weren't their pin: %lu\n", (unsigned long)BenchWrong);
+	if( BenchPollClk ){
+		printf("  FAIL: the scan polls\n");
+		fail++;
+	}//end if
+	if( BenchWrong ){
+		printf("  FAIL: a read wasn't its pin\n");
+		fail++;
+	}//end if
+
+	return fail;
+
+}//end benchScan
+
+static int benchSleep(void){
+/*	Desc:		Runs the sleep section.
+*	Ret:		Failures.
+*/
+
+	//Local variables
+	double		s		= 10;
+	int64_t		halt	= BenchHalt;
+	uint8_t		i;
+	int			fail	= 0;
+
+	benchClear();
+	benchRun(s * 1000);
+
+	printf("\nsleep, %.0f s with the pins held still\n", s);
+	printf("  conversion, us / s: %.0f with clkIO running, %.0f with it halted\n",
+		( BenchConvClk - BenchConvHalt ) / s / BENCH_CLK_US, BenchConvHalt / s / BENCH_CLK_US);
+	printf("  SIG_ADC runs per result:");
+	for( i = 0; i < A2D_SCAN_NUM; i++ )
+		printf("  %s %.1f", BenchName[i], (double)BenchSlotIsrs[i] / BenchCount[i]);
+	printf("\n  frame stretch %.0f us / s, %.0f sleeps / s, %lu with a pulse high\n",
+		( BenchHalt - halt ) / s / BENCH_CLK_US, BenchSleeps / s, (unsigned long)BenchSleepHigh);
+	printf("  behind the clock, us: MS_TIMER %lld to %lld, drift %lld; timerGetUs %lld to %lld, drift %lld\n",
+		(long long)BenchMsErr[1], (long long)BenchMsErr[2], (long long)( BenchMsLast - BenchMsErr[0] ),
+		(long long)BenchUsErr[1], (long long)BenchUsErr[2], (long long)( BenchUsLast - BenchUsErr[0] ));
+	if( BenchSleepHigh || !BenchConvHalt ){
+		printf("  FAIL: %s\n", BenchSleepHigh ? "slept with a pulse high" : "no conversion asleep");
+		fail++;
+	}//end if
+	if(		llabs(BenchMsLast - BenchMsErr[0]) >= BENCH_DRIFT_SLEEP * (int64_t)BenchSleeps
+		||	llabs(BenchUsLast - BenchUsErr[0]) >= BENCH_DRIFT_SLEEP * (int64_t)BenchSleeps ){
+		printf("  FAIL: the time drifts\n");
+		fail++;
+	}//end if
+
+	return fail;
+
+}//end benchSleep
+
+static int benchSettle(void){
+/*	Desc:		Runs the settle section.
+*	Ret:		Failures.
+*/
+
+	//Local variables
+	static const double	tau[] = { 1, 4, 16 };
+	double		s		= 10;
+	uint32_t	results;
+	uint8_t		t;
+	uint8_t		i;
+	int			fail	= 0;
+
+	printf("\nsettle, %.0f s with the pins held still for each input time constant\n", s);
+	printf("  %6s %34s %10s %10s\n", "tau us", "worst error, 12 bit counts", "results/s", "discards/s");
+	printf("  %6s", "");
+	for( i = 0; i < A2D_SCAN_NUM; i++ )
+		printf(" %8s", BenchName[i]);
+	printf("\n");
+
+	for( t = 0; t < sizeof(tau) / sizeof(tau[0]); t++ ){
+
+		benchClear();
+		BenchTau = tau[t];
+		benchRun(s * 1000);
+
+		results = 0;
+		printf("  %6.0f", tau[t]);
+		for( i = 0; i < A2D_SCAN_NUM; i++ ){
+			printf(" %8.1f", BenchErr[i]);
+			results += BenchCount[i];
+			if( tau[t] == 4 && A2dScan[i].Discard && BenchErr[i] > 4 )
+				fail++;
+		}//end for
+		printf(" %10.1f %10.1f\n", results / s, BenchDiscards / s);
+
+	}//end for
+	BenchTau = 0;
+
+	if( fail )
+		printf("  FAIL: a channel that discards is off by more than a 10 bit count at 4 us\n");
+
+	return fail;
+
+}//end benchSettle
+
+static int benchProfile(void){
+/*	Desc:		Runs the profile section.
+*	Ret:		Failures.
+*/
+
+	//Local variables
+	double		s		= 10;
+	uint8_t		ch;
+	uint8_t		i;
+	int			fail	= 0;
+
+	benchClear();
+	BenchSlope	= 1024.0 / ( s * 1000000 * BENCH_CLK_US );
+	BenchNoise	= TRUE;
+	benchRun(s * 1000);
+	BenchSlope	= 0;
+	BenchNoise	= FALSE;
+
+	printf("\nprofile, %.0f s, pins ramping, noise %.1f / %.1f counts rms\n",
+		s, BENCH_NOISE_PRECISE, BENCH_NOISE_FAST);
+	printf("  %8s %8s %8s %8s %8s  (error in 12 bit counts)\n", "channel", "a2d kHz", "conv us", "rms", "worst");
+	for( i = 0; i < A2D_SCAN_NUM; i++ ){
+
+		ch = A2dScan[i].Ch;
+		printf("  %8s %8.0f %8.1f %8.1f %8.1f\n", BenchName[i],
+			13.0 * F_OSC / 1000 * BenchChConvs[ch] / BenchChClk[ch],
+			(double)BenchChClk[ch] / BenchChConvs[ch] / BENCH_CLK_US,
+			sqrt(BenchErrSq[i] / BenchCount[i]), BenchErr[i]);
+		if( BenchErr[i] > ( ( ch == A2D_SWITCH_CH ) ? A2D_FULL_SCALE / 100 : BENCH_POT_ERR ) ){
+			printf("  FAIL: %s is off by %.1f\n", BenchName[i], BenchErr[i]);
+			fail++;
+		}//end if
+
+	}//end for
+
+	return fail;
+
+}//end benchProfile
+
+int main(void){
+
+	//Local variables
+	int			fail	= 0;
+
+	benchInit();
+	fail += benchScan();
+	fail += benchSleep();
+	fail += benchSettle();
+	fail += benchProfile();
+
+	printf("%d failures\n", fail);
+
+	return fail ? 1 : 0;
+
+}//end main
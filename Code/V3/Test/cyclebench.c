@@ -0,0 +1,140 @@
+/*	File:	cyclebench.c
+*	Desc:	Host benchmark of the open/close cycle time the motion
+*			profile in motion.c gives for each Speed setting.
+*	Proj:	AutoMotion
+*
+*	NOTES:
+*
+*		Each cycle is a trapezoid move from PWM_CLOSED_DFLT to
+*	PWM_OPEN_DFLT and back, at the default acceleration.  The frames
+*	are run until the move arrives, so the time includes the frame the
+*	ISR lands on the target.  It is printed for 50, 200 and 333 Hz beside
+*	the old fixed step mover, PWM_ADJ_RESOLUTION us every Speed + 1 ms,
+*	and the step as the servo passes the middle, the cruise speed.
+*
+*		The fastest settings never reach their top speed on a move this
+*	short, the acceleration limits them, so they all take the same time.
+*	From the first setting that does, the check fails if the next
+*	slower setting does not cruise slower and take longer.
+*/
+
+#include <stdio.h>
+#include "includes.h"
+
+static uint8_t		BenchOut;
+
+void SetPWMDuty(uint8_t ch, uint16_t duty){
+
+	(void)ch;
+	(void)duty;
+
+}//end SetPWMDuty
+
+void SetPWMOutput(uint8_t ch, bool on){
+
+	if( on )
+		BenchOut |= 1<<ch;
+	else
+		BenchOut &= ~(1<<ch);
+
+}//end SetPWMOutput
+
+bool GetPWMOutput(uint8_t ch){
+
+	return ( BenchOut>>ch ) & 1;
+
+}//end GetPWMOutput
+
+#include "../Source/motion.c"
+
+#define BENCH_SPEEDS	64
+
+static uint32_t benchMove(uint16_t duty, int32_t *cruise){
+/*	Desc:		Moves channel 0 to duty and runs it there.
+*	Args:		duty, x 1 us.
+*				cruise, set to the step across the middle, Q7.
+*	Ret:		Frames taken.
+*/
+
+	//Local variables
+	uint32_t	frames	= 0;
+	uint32_t	pos;
+	uint32_t	mid;
+	int32_t		step;
+	uint8_t		ch;
+	uint16_t	d;
+
+	mid = ((uint32_t)(PWM_OPEN_DFLT + PWM_CLOSED_DFLT)<<MOTION_PLAN_SHIFT) / 2;
+	motionMoveTo(0, duty, MOTION_PROFILE_TRAP);
+	motionService();
+
+	while( motionBusy(0) ){
+
+		pos = MotionCh[0].Pos;
+		motionFrame();
+		frames++;
+		if( ( pos < mid ) != ( MotionCh[0].Pos < mid ) ){
+			step	= (int32_t)(MotionCh[0].Pos - pos);
+			*cruise	= ( step < 0 ) ? -step : step;
+		}//end if
+
+	}//end while
+
+	while( motionGetEvent(&ch, &d) );
+
+	return frames;
+
+}//end benchMove
+
+int main(void){
+
+	//Local variables
+	static const uint16_t	frameUs[]	= { 20000, 5000, 3000 };
+	static const uint8_t	shown[]		= { 0, 1, 2, 4, 6, 7, 8, 12, 16, 24, 32, 48, 63 };
+	uint32_t	ms[3][BENCH_SPEEDS];
+	int32_t		cruise[3][BENCH_SPEEDS];
+	uint8_t		f;
+	uint8_t		s;
+	uint8_t		i;
+	int			fail = 0;
+
+	for( f = 0; f < 3; f++ ){
+		for( s = 0; s < BENCH_SPEEDS; s++ ){
+
+			motionInit(PWM_CLOSED_DFLT);
+			motionSetFrame(frameUs[f]);
+			motionSetSpeed(s);
+			cruise[f][s]	= 0;
+			ms[f][s]		= benchMove(PWM_OPEN_DFLT, &cruise[f][s]);
+			ms[f][s]		+= benchMove(PWM_CLOSED_DFLT, &cruise[f][s]);
+			ms[f][s]		= ms[f][s] * frameUs[f] / 1000;
+
+			if(		s && cruise[f][s - 1] < cruise[f][0]
+				&&	( cruise[f][s] >= cruise[f][s - 1] || ms[f][s] <= ms[f][s - 1] ) ){
+				if( fail++ < 5 )
+					printf("  FAIL: %u Hz, Speed %u is no slower than Speed %u\n",
+						1000000U / frameUs[f], s, s - 1);
+			}//end if
+
+		}//end for
+	}//end for
+
+	printf("open/close cycle, %u to %u us and back, ms, and cruise, us / frame\n",
+		PWM_CLOSED_DFLT, PWM_OPEN_DFLT);
+	printf("%5s %8s %16s %16s %16s\n", "Speed", "fixed", "50 Hz", "200 Hz", "333 Hz");
+	for( i = 0; i < sizeof(shown); i++ ){
+
+		s = shown[i];
+		printf("%5u %8lu", s,
+			2UL * (PWM_OPEN_DFLT - PWM_CLOSED_DFLT) / PWM_ADJ_RESOLUTION * (s + 1));
+		for( f = 0; f < 3; f++ )
+			printf(" %8lu %7.2f", (unsigned long)ms[f][s], (double)cruise[f][s] / (1<<MOTION_PLAN_SHIFT));
+		printf("\n");
+
+	}//end for
+
+	printf("%d failures\n", fail);
+
+	return fail ? 1 : 0;
+
+}//end main
@@ -0,0 +1,159 @@
+/*	File:	filterbench.c
+*	Desc:	Host benchmark of the servo parameter wakeups the pot
+*			filters in filter.c save.
+*	Proj:	AutoMotion
+*
+*	NOTES:
+*
+*		There is no recorded a2d trace in the tree, so the trace is made
+*	up: an open limit pot left alone for an hour at 20 ms a sample, 12
+*	bit results with gaussian noise, a spike of +-40 counts one sample in
+*	500 for servo current on the supply, and a slow drift of 8 counts
+*	over the hour.  A wakeup is a sample that changes UpperLimit, which
+*	re-arms the servo.  It is counted for the old unfiltered
+*	PWM_OPEN_LIM - 3*(x>>4) and for the filter main.c runs, at
+*	PARAM_ALPHA and PARAM_LIM_DEADBAND.  The sample period back off in
+*	main.c is left out, so the filter is run on every sample.
+*
+*		The pot is then turned a quarter of its range in 1 s, and the
+*	time for UpperLimit to come within 3 us of where it ends up is
+*	reported.  The check fails if the filter wakes the servo more than
+*	BENCH_QUIET_MAX times an hour at the middle noise level, or takes
+*	longer than BENCH_TRACK_MS to follow the turn.
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include "includes.h"
+#include "../Source/filter.c"
+
+//Same as main.c
+#define PARAM_ALPHA			64
+#define PARAM_LIM_DEADBAND	16
+
+#define BENCH_PERIOD_MS		20
+#define BENCH_HOUR			( 3600000UL / BENCH_PERIOD_MS )
+#define BENCH_QUIET_MAX		10
+#define BENCH_TRACK_MS		500
+
+static uint32_t		BenchSeed = 1;
+
+static double benchGauss(void){
+
+	//Local variables
+	double		u;
+	double		v;
+
+	BenchSeed	= BenchSeed * 1103515245UL + 12345;
+	u			= ( (BenchSeed>>8) + 1.0 ) / 16777217.0;
+	BenchSeed	= BenchSeed * 1103515245UL + 12345;
+	v			= ( BenchSeed>>8 ) / 16777216.0;
+
+	return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+
+}//end benchGauss
+
+static uint16_t benchSample(double value, double sigma){
+/*	Desc:		Makes one a2d result.
+*	Args:		value, pot, 12 bit counts.
+*				sigma, noise, counts.
+*	Ret:		12 bit result.
+*/
+
+	BenchSeed = BenchSeed * 1103515245UL + 12345;
+	if( !( (BenchSeed>>8) % 500 ) )
+		value += ( BenchSeed & 0x100 ) ? 40 : -40;
+	value += sigma * benchGauss();
+
+	if( value < 0 )
+		value = 0;
+	if( value > 4095 )
+		value = 4095;
+
+	return (uint16_t)( value + 0.5 );
+
+}//end benchSample
+
+static uint16_t benchLimit(uint16_t x){
+
+	return PWM_OPEN_LIM - ((3 * x)>>4);
+
+}//end benchLimit
+
+int main(void){
+
+	//Local variables
+	static const double	sigmas[]	= { 2.0, 6.0, 12.0 };
+	FILTER_CH	filter;
+	uint32_t	i;
+	uint32_t	rawWakes;
+	uint32_t	filterWakes;
+	uint32_t	trackMs;
+	uint16_t	x;
+	uint16_t	raw;
+	uint16_t	lim;
+	uint16_t	end;
+	double		pot;
+	uint8_t		s;
+	int			fail	= 0;
+
+	printf("wakeups per hour, pot left alone, and ms to follow a 1 s turn\n");
+	printf("%8s %10s %10s %10s\n", "noise", "raw", "filtered", "follow ms");
+
+	for( s = 0; s < sizeof(sigmas) / sizeof(sigmas[0]); s++ ){
+
+		BenchSeed	= 1;
+		pot			= 2048;
+		x			= benchSample(pot, sigmas[s]);
+		raw			= benchLimit(x);
+		filterInit(&filter, PARAM_ALPHA, PARAM_LIM_DEADBAND, x);
+		lim			= benchLimit(filterOutput(&filter));
+		rawWakes	= 0;
+		filterWakes	= 0;
+
+		//An hour left alone
+		for( i = 0; i < BENCH_HOUR; i++ ){
+
+			x = benchSample(pot + 8.0 * i / BENCH_HOUR, sigmas[s]);
+			if( benchLimit(x) != raw ){
+				raw = benchLimit(x);
+				rawWakes++;
+			}//end if
+			if( filterUpdate(&filter, x) && benchLimit(filterOutput(&filter)) != lim ){
+				lim = benchLimit(filterOutput(&filter));
+				filterWakes++;
+			}//end if
+
+		}//end for
+
+		//A quarter turn in 1 s, then left
+		pot		+= 8.0;
+		end		= benchLimit((uint16_t)( pot + 1024 ));
+		trackMs	= 0;
+		for( i = 1; i <= 3000 / BENCH_PERIOD_MS; i++ ){
+
+			if( i <= 1000 / BENCH_PERIOD_MS )
+				pot += 1024.0 * BENCH_PERIOD_MS / 1000;
+			filterUpdate(&filter, benchSample(pot, sigmas[s]));
+			lim = benchLimit(filterOutput(&filter));
+			if( ( lim > end + 3 || lim + 3 < end ) )
+				trackMs = 0;
+			else if( !trackMs )
+				trackMs = i * BENCH_PERIOD_MS;
+
+		}//end for
+		trackMs = trackMs ? trackMs - 1000 : 3000;
+
+		printf("%8.1f %10lu %10lu %10lu\n", sigmas[s],
+			(unsigned long)rawWakes, (unsigned long)filterWakes, (unsigned long)trackMs);
+
+		if( s == 1 && ( filterWakes > BENCH_QUIET_MAX || trackMs > BENCH_TRACK_MS ) )
+			fail++;
+
+	}//end for
+
+	printf("%d failures\n", fail);
+
+	return fail ? 1 : 0;
+
+}//end main
@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+#	File:	int16.py
+#	Desc:	Parses the sources the way avr-gcc sees them for the
+#			atmega8, where int is 16 bits, and reports arithmetic
+#			that a host build with a 32 bit int gets right but the
+#			part does not:
+#
+#			- constant expressions that overflow int, or unsigned int
+#			  for products and shifts,
+#			- 16 bit products, shifts, sums and differences that are
+#			  converted to a 32 bit type after they have already
+#			  wrapped; the cast has to go on an operand instead.
+#
+#	Usage:	int16.py [-Dname[=value] ...] [-Idir ...] file.c ...
+#	Ret:	Exit status 1 if anything was reported.
+#	Proj:	AutoMotion
+#
+#	NOTES:
+#
+#		Needs the libclang python package; clang parses for the avr
+#	target, so the integer types have the part's sizes.  Only the
+#	avr-libc headers are stubbed, from Stub and Stub/Int16.
+
+import ctypes
+import os
+import sys
+
+import clang.cindex as ci
+
+TEST_DIR = os.path.dirname(os.path.abspath(__file__))
+PROJ_DIR = os.path.dirname(TEST_DIR)
+
+#Binary operator kinds from CXBinaryOperatorKind
+OP_MUL, OP_ADD, OP_SUB, OP_SHL = 3, 6, 7, 8
+OP_NAME = {OP_MUL: '*', OP_ADD: '+', OP_SUB: '-', OP_SHL: '<<'}
+
+#CXEvalResultKind for an integer
+EVAL_INT = 1
+
+INT_KINDS = (ci.TypeKind.INT, ci.TypeKind.UINT)
+
+
+def libSetup():
+	lib = ci.conf.lib
+	lib.clang_getCursorBinaryOperatorKind.argtypes = [ci.Cursor]
+	lib.clang_getCursorBinaryOperatorKind.restype = ctypes.c_int
+	lib.clang_Cursor_Evaluate.argtypes = [ci.Cursor]
+	lib.clang_Cursor_Evaluate.restype = ctypes.c_void_p
+	lib.clang_EvalResult_getKind.argtypes = [ctypes.c_void_p]
+	lib.clang_EvalResult_getKind.restype = ctypes.c_int
+	lib.clang_EvalResult_isUnsignedInt.argtypes = [ctypes.c_void_p]
+	lib.clang_EvalResult_isUnsignedInt.restype = ctypes.c_uint
+	lib.clang_EvalResult_getAsLongLong.argtypes = [ctypes.c_void_p]
+	lib.clang_EvalResult_getAsLongLong.restype = ctypes.c_longlong
+	lib.clang_EvalResult_getAsUnsigned.argtypes = [ctypes.c_void_p]
+	lib.clang_EvalResult_getAsUnsigned.restype = ctypes.c_ulonglong
+	lib.clang_EvalResult_dispose.argtypes = [ctypes.c_void_p]
+	lib.clang_EvalResult_dispose.restype = None
+	return lib
+
+
+LIB = libSetup()
+
+
+def evaluate(cursor):
+	"""Value of a constant integer expression, or None."""
+	res = LIB.clang_Cursor_Evaluate(cursor)
+	if not res:
+		return None
+	try:
+		if LIB.clang_EvalResult_getKind(res) != EVAL_INT:
+			return None
+		if LIB.clang_EvalResult_isUnsignedInt(res):
+			return LIB.clang_EvalResult_getAsUnsigned(res)
+		return LIB.clang_EvalResult_getAsLongLong(res)
+	finally:
+		LIB.clang_EvalResult_dispose(res)
+
+
+def intType(cursor, size):
+	"""Signedness if cursor has int or unsigned int type of size bytes."""
+	t = cursor.type.get_canonical()
+	if t.kind not in INT_KINDS and not (size == 4 and t.kind in (ci.TypeKind.LONG, ci.TypeKind.ULONG)):
+		return None
+	if t.get_size() != size:
+		return None
+	return 'unsigned' if t.kind in (ci.TypeKind.UINT, ci.TypeKind.ULONG) else 'signed'
+
+
+def constOverflow(cursor, op, sign):
+	"""Message if a constant 16 bit operation does not fit its type."""
+	kids = list(cursor.get_children())
+	if len(kids) != 2:
+		return None
+	a, b = evaluate(kids[0]), evaluate(kids[1])
+	if a is None or b is None:
+		return None
+	if op == OP_MUL:
+		val = a * b
+	elif op == OP_ADD:
+		val = a + b
+	elif op == OP_SUB:
+		val = a - b
+	else:
+		val = a << b
+	if sign == 'signed':
+		bad = not -0x8000 <= val <= 0x7FFF
+	else:
+		bad = op in (OP_MUL, OP_SHL) and not 0 <= val <= 0xFFFF
+	if not bad:
+		return None
+	return 'constant %d %s %d = %d overflows 16 bit %s int' % (a, OP_NAME[op], b, val, sign)
+
+
+class Checker:
+
+	def __init__(self, args):
+		self.args = args
+		self.found = {}
+
+	def report(self, cursor, msg):
+		loc = cursor.location
+		if loc.file is None:
+			return
+		name = os.path.relpath(loc.file.name, PROJ_DIR)
+		self.found.setdefault((name, loc.line, loc.column), msg)
+
+	def ours(self, cursor):
+		loc = cursor.location
+		return loc.file is not None and not os.path.abspath(loc.file.name).startswith(TEST_DIR)
+
+	def walk(self, cursor, parents):
+		if cursor.kind == ci.CursorKind.BINARY_OPERATOR and self.ours(cursor):
+			self.binary(cursor, parents)
+		parents.append(cursor)
+		for kid in cursor.get_children():
+			self.walk(kid, parents)
+		parents.pop()
+
+	def binary(self, cursor, parents):
+		op = LIB.clang_getCursorBinaryOperatorKind(cursor)
+		if op not in OP_NAME:
+			return
+		sign = intType(cursor, 2)
+		if sign is None:
+			return
+
+		msg = constOverflow(cursor, op, sign)
+		if msg:
+			self.report(cursor, msg)
+			return
+		if evaluate(cursor) is not None:
+			return
+
+		#Look through parentheses for a conversion to 32 bits
+		i = len(parents) - 1
+		while i >= 0 and parents[i].kind == ci.CursorKind.PAREN_EXPR:
+			i -= 1
+		if i < 0:
+			return
+		up = parents[i]
+		if up.kind not in (ci.CursorKind.UNEXPOSED_EXPR, ci.CursorKind.CSTYLE_CAST_EXPR):
+			return
+		if intType(up, 4) is None:
+			return
+		self.report(cursor, '16 bit %s int %s is widened to %s after it is done'
+			% (sign, OP_NAME[op], up.type.spelling))
+
+	def check(self, path):
+		index = ci.Index.create()
+		tu = index.parse(path, args=self.args)
+		ok = True
+		for diag in tu.diagnostics:
+			if diag.severity >= ci.Diagnostic.Error:
+				print('%s: %s' % (path, diag))
+				ok = False
+		self.walk(tu.cursor, [])
+		return ok
+
+
+def main(argv):
+	flags = [a for a in argv if a.startswith('-')]
+	files = [a for a in argv if not a.startswith('-')]
+	args = ['-target', 'avr', '-mmcu=atmega8', '-std=gnu99', '-nostdinc', '-ffreestanding',
+		'-funsigned-char', '-fshort-enums',
+		'-I' + os.path.join(TEST_DIR, 'Stub', 'Int16'),
+		'-I' + os.path.join(TEST_DIR, 'Stub'),
+		'-I' + os.path.join(PROJ_DIR, 'Include'),
+		'-DGCC_MEGA_AVR'] + flags
+
+	checker = Checker(args)
+	ok = True
+	for path in files:
+		ok = checker.check(path) and ok
+	for (name, line, col), msg in sorted(checker.found.items()):
+		print('%s:%d:%d: %s' % (name, line, col, msg))
+	return 0 if ok and not checker.found else 1
+
+
+if __name__ == '__main__':
+	sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,423 @@
+/*	File:	isrbench.c
+*	Desc:	Host benchmark of how long the servo ISRs wait on TCNT1,
+*			the old tick ISR mover beside the frame ISR path in
+*			timer.c, motion.c and InputOutput.c.
+*	Proj:	AutoMotion
+*
+*	NOTES:
+*
+*		The model counts us.  TCNT1 counts from the frame start and each
+*	read of it takes BENCH_READ_US, about a pass of a wait loop on it, so
+*	a loop that waits on TCNT1 moves the time along.  Every ISR runs with
+*	interrupts off, so the time it waits is time no other interrupt can
+*	run.  The code's own cycles are not in it, that needs the part or a
+*	simulator; the waits were the part that could be thousands of them.
+*
+*		old: before the frame ISR path the motion code ran in the 1 ms
+*	TOC2 ISR.  It stepped the duty PWM_ADJ_RESOLUTION us every Speed + 1
+*	ms, waited with while( TCNT1 <= OCR1A ) before each SetPWMDuty(), and
+*	again before PWM_OFF at the hum timeout.  benchOldTick() is that
+*	code.  new: the tick ISR runs timerTickElapsed() and
+*	timerSetNextTick() as in main.c; a2dTick() and schedTick() don't
+*	touch TOC1 and are left out.  SIG_OVERFLOW1 runs at each frame start
+*	and SIG_OUTPUT_COMPARE1A at the pulse end while it is enabled.
+*
+*		Both move the servo to a pseudo random target at a pseudo random
+*	Speed every 1 to 4 s, with a rest long enough for the hum timeout one
+*	time in 4, for 10 minutes.  It reports the worst and mean wait of the
+*	ISRs that waited, and how many did.  It fails if an ISR of the new
+*	path reads TCNT1 at all.  It is built with four channels, and moves
+*	channel 0; the others are parked, with their PWM off.
+*
+*		wakes: the software channels, 2 and 3, get pseudo random pulses
+*	for BENCH_WAKE_FRAMES frames, as in swpwmbench, with PWMFrameStart()
+*	at each frame start.  SIG_OVERFLOW0 is entered BENCH_ENTRY_US after
+*	each TOC0 overflow, once on time and once with every wake held up
+*	BENCH_HOLD_US more by another ISR.  A pin goes low at the TCNT1 read
+*	after the PORTD write.  It reports the longest SIG_OVERFLOW0 run and
+*	the latest pulse end.  It fails if a run is longer than PWM_SW_LEAD
+*	and a us for each end, an on time pulse end is more than 2 us late,
+*	or a held up one later than the hold-up and the entry.
+*/
+
+#include <stdio.h>
+
+#define PWM_CH_NUM			4
+#define STUB_TCNT1_FUNC
+
+#include "includes.h"
+
+uint16_t a2dGetSample(uint8_t channel){
+
+	(void)channel;
+	return 0;
+
+}//end a2dGetSample
+
+uint16_t a2dGetSampleTime(uint8_t channel, uint32_t *us){
+
+	(void)channel;
+	*us = 0;
+	return 0;
+
+}//end a2dGetSampleTime
+
+void a2dInit(void){
+}//end a2dInit
+
+#define BENCH_READ_US	1
+#define BENCH_FRAME		( (int64_t)TOC1_FRAME_US )
+#define BENCH_RUN_US	600000000LL
+#define BENCH_ENTRY_US	4
+#define BENCH_HOLD_US	60
+#define BENCH_WAKE_FRAMES	10000
+#define BENCH_SW_WAIT	( PWM_SW_NUM * ( PWM_SW_LEAD / PWM_US(1) + 1 ) * BENCH_READ_US )
+
+static int64_t		BenchUs;		//now
+static uint32_t		BenchReads;
+static uint32_t		BenchSeed = 1;
+static uint8_t		BenchPins;		//software PWM pins at the last read
+static int64_t		BenchEdge[2];	//when each went low, -1 if not yet
+
+static void benchPins(void){
+
+	//Local variables
+	uint8_t		i;
+
+	for( i = 0; i < 2; i++ ){
+		if( ( BenchPins & ~PORTD ) & ( 1<<(PD6 + i) ) )
+			BenchEdge[i] = BenchUs;
+	}//end for
+	BenchPins = PORTD & PWM_SW_PINS;
+
+}//end benchPins
+
+uint16_t stubTcnt1(void){
+
+	//Local variables
+	uint16_t	count;
+
+	benchPins();
+	count		= PWM_US(BenchUs % BENCH_FRAME);
+	BenchUs		+= BENCH_READ_US;
+	BenchReads++;
+
+	return count;
+
+}//end stubTcnt1
+
+#include "../Source/timer.c"
+#include "../Source/motion.c"
+#include "../Source/InputOutput.c"
+
+static uint32_t benchRand(uint32_t range){
+
+	BenchSeed = BenchSeed * 1103515245UL + 12345;
+	return (BenchSeed>>8) % range;
+
+}//end benchRand
+
+//State of the old mover
+static uint16_t		BenchCurrent;
+static uint16_t		BenchDesired;
+static uint16_t		BenchSpeed;
+static uint16_t		BenchSpeedTimer;
+static uint16_t		BenchHumCount;
+
+static void benchOldTick(void){
+/*	Desc:		The motion code of the 1 ms TOC2 ISR before the frame ISR
+*				path, with its TCNT1 waits.
+*/
+
+	if( !BenchSpeedTimer ){
+
+		if( BenchCurrent < BenchDesired - ( PWM_ADJ_RESOLUTION + 1 ) ){
+
+			BenchCurrent += PWM_ADJ_RESOLUTION;
+			while( TCNT1 <= OCR1A ){};
+			OCR1A = PWM_US(BenchCurrent);
+			PWM_ON;
+			BenchSpeedTimer = BenchSpeed;
+
+		}//end if
+		else if( BenchCurrent > BenchDesired + ( PWM_ADJ_RESOLUTION + 1 ) ){
+
+			BenchCurrent -= PWM_ADJ_RESOLUTION;
+			while( TCNT1 <= OCR1A ){};
+			OCR1A = PWM_US(BenchCurrent);
+			PWM_ON;
+			BenchSpeedTimer = BenchSpeed;
+
+		}//end else if
+		else if( ( DDRB & ( 1<<PB1 ) ) && !BenchHumCount )
+			BenchHumCount = HUM_TIMEOUT;
+
+	}//end if
+	else
+		BenchSpeedTimer--;
+
+	if( BenchHumCount && !--BenchHumCount ){
+		while( TCNT1 <= OCR1A ){};
+		PWM_OFF;
+	}//end if
+
+}//end benchOldTick
+
+typedef struct{
+	int64_t		Most;
+	int64_t		Sum;
+	uint32_t	Waits;
+	uint32_t	Runs;
+	uint32_t	Reads;
+}BENCH_WAIT;
+
+static void benchWait(BENCH_WAIT *w, int64_t start, uint32_t reads){
+/*	Desc:		Adds one ISR run.
+*	Args:		w, ISR totals.
+*				start, us the ISR was entered.
+*				reads, TCNT1 reads before it.
+*/
+
+	//A read in each of the two loops finds the pin low without waiting
+	w->Runs++;
+	w->Reads += BenchReads - reads;
+	if( BenchUs - start > 2 * BENCH_READ_US ){
+		w->Waits++;
+		w->Sum += BenchUs - start;
+		if( BenchUs - start > w->Most )
+			w->Most = BenchUs - start;
+	}//end if
+
+}//end benchWait
+
+static void benchPrint(const char *name, const BENCH_WAIT *w){
+
+	printf("  %-22s %8lld %8.1f %9lu %9lu %9lu\n", name, (long long)w->Most,
+		w->Waits ? (double)w->Sum / w->Waits : 0.0, (unsigned long)w->Waits,
+		(unsigned long)w->Runs, (unsigned long)w->Reads);
+
+}//end benchPrint
+
+static void benchWake(int64_t hold, int64_t *wait, int64_t *late){
+/*	Desc:		Runs the software channels' pulse ends, with every
+*				TOC0 wake held up by another ISR.
+*	Args:		hold, us each wake is held up.
+*				wait, set to the longest SIG_OVERFLOW0 run, from its
+*				entry, with interrupts off.
+*				late, set to the latest pulse end, against its time.
+*/
+
+	//Local variables
+	uint16_t	duty[2];
+	uint16_t	end[2]	= { 0, 0 };
+	uint32_t	f;
+	int64_t		frame;
+	int64_t		entry;
+	uint8_t		i;
+	uint8_t		j;
+
+	*wait		= 0;
+	*late		= 0;
+	BenchSeed	= 1;
+	SetPWMOutput(2, TRUE);
+	SetPWMOutput(3, TRUE);
+
+	for( f = 0; f < BENCH_WAKE_FRAMES; f++ ){
+
+		//Pulses as in swpwmbench, some the same and some a few us apart
+		duty[0] = 750 + benchRand(1501);
+		switch( benchRand(4) ){
+			case 0:		duty[1] = duty[0];						break;
+			case 1:		duty[1] = duty[0] + benchRand(8);		break;
+			default:	duty[1] = 750 + benchRand(1501);		break;
+		}//end switch
+		SetPWMDuty(2, PWM_US(duty[0]));
+		SetPWMDuty(3, PWM_US(duty[1]));
+
+		frame			= ( BenchUs / BENCH_FRAME + 1 ) * BENCH_FRAME;
+		BenchUs			= frame;
+		BenchEdge[0]	= BenchEdge[1] = -1;
+		PWMFrameStart();
+		BenchPins		= PORTD & PWM_SW_PINS;
+		for( j = 0; j < PwmSwEdges; j++ ){
+			for( i = 0; i < 2; i++ )
+				if( PwmSwMask[j] & ( 1<<(PD6 + i) ) )
+					end[i] = PwmSwEnd[j]>>TOC1_CNT_SHIFT;
+		}//end for
+
+		while( TCCR0 ){
+
+			//Overflow, then the other ISR and the entry
+			entry	= BenchUs + 256 - TCNT0 + hold + BENCH_ENTRY_US;
+			BenchUs	= entry;
+			SIG_OVERFLOW0();
+			benchPins();
+			if( BenchUs - entry > *wait )
+				*wait = BenchUs - entry;
+
+		}//end while
+
+		for( i = 0; i < 2; i++ ){
+			if( BenchEdge[i] - frame - end[i] > *late )
+				*late = BenchEdge[i] - frame - end[i];
+		}//end for
+
+	}//end for
+
+}//end benchWake
+
+static int64_t benchNextMove(uint16_t *duty, uint16_t *speed){
+/*	Desc:		Picks the next move.
+*	Args:		duty, gets the target, x 1 us.
+*				speed, gets the Speed, 0 to 15.
+*	Ret:		us to the move after it.
+*/
+
+	*duty	= PWM_CLSD_LIM + benchRand(PWM_OPEN_LIM - PWM_CLSD_LIM + 1);
+	*speed	= benchRand(16);
+
+	return 1000000LL * ( 1 + benchRand(4) ) + ( benchRand(4) ? 0 : HUM_TIMEOUT * 1000LL );
+
+}//end benchNextMove
+
+int main(void){
+
+	//Local variables
+	BENCH_WAIT	oldTick		= { 0, 0, 0, 0, 0 };
+	BENCH_WAIT	newTick		= { 0, 0, 0, 0, 0 };
+	BENCH_WAIT	newFrame	= { 0, 0, 0, 0, 0 };
+	BENCH_WAIT	newCompare	= { 0, 0, 0, 0, 0 };
+	int64_t		wakeWait;
+	int64_t		wakeLate;
+	int64_t		heldWait;
+	int64_t		heldLate;
+	int64_t		tick;
+	int64_t		frame;
+	int64_t		move;
+	int64_t		end;
+	int64_t		start;
+	uint32_t	reads;
+	uint16_t	duty;
+	uint16_t	speed;
+	uint8_t		ch;
+	int			fail		= 0;
+
+	//Old mover, a tick every ms
+	BenchCurrent	= BenchDesired = PWM_CENTER_DFLT;
+	OCR1A			= PWM_US(BenchCurrent);
+	PWM_ON;
+	move			= 0;
+	for( tick = 0; tick < BENCH_RUN_US; tick += 1000 ){
+
+		if( tick >= move ){
+			move			+= benchNextMove(&BenchDesired, &BenchSpeed);
+			BenchSpeedTimer	= 0;
+		}//end if
+
+		start = BenchUs = ( BenchUs > tick ) ? BenchUs : tick;
+		reads = BenchReads;
+		benchOldTick();
+		benchWait(&oldTick, start, reads);
+
+	}//end for
+
+	//New path, the same moves
+	BenchSeed	= 1;
+	BenchUs		= 0;
+	BenchReads	= 0;
+	OCR2		= 0;
+	timerInit();
+	IOInit();
+	motionInit(PWM_CENTER_DFLT);
+	motionSetHold(500, 2);		//HOLD_PERIOD, HOLD_BURST in main.c
+	SetPWMOutput(0, TRUE);
+	//One servo, the other channels stay parked and off
+	for( ch = 1; ch < PWM_CH_NUM; ch++ ){
+		SetPWMOutput(ch, FALSE);
+		motionPark(ch);
+	}//end for
+	tick		= 1000;
+	frame		= BENCH_FRAME;
+	move		= 0;
+	while( BenchUs < BENCH_RUN_US ){
+
+		//Main loop between interrupts
+		if( BenchUs >= move ){
+			move += benchNextMove(&duty, &speed);
+			motionSetSpeed(speed);
+			motionMoveTo(0, duty, MOTION_PROFILE_TRAP);
+		}//end if
+		motionService();
+		while( motionGetEvent(&ch, &duty) );
+
+		//Next interrupt: the tick, the pulse end while its ISR is on, or
+		//	the frame.  A pulse end already past matches next frame.
+		end = ( TIMSK & ( 1<<OCIE1A ) ) ? frame - BENCH_FRAME + OCR1A : frame;
+		if( end < BenchUs )
+			end = frame;
+		if( tick <= end && tick <= frame ){
+
+			start = BenchUs = ( BenchUs > tick ) ? BenchUs : tick;
+			reads = BenchReads;
+			timerTickElapsed();
+			timerSetNextTick(20);
+			tick += TimerTickMs * 1000;
+			benchWait(&newTick, start, reads);
+
+		}//end if
+		else if( end < frame ){
+
+			start = BenchUs = ( BenchUs > end ) ? BenchUs : end;
+			reads = BenchReads;
+			SIG_OUTPUT_COMPARE1A();
+			benchWait(&newCompare, start, reads);
+
+		}//end else if
+		else{
+
+			start = BenchUs = ( BenchUs > frame ) ? BenchUs : frame;
+			reads = BenchReads;
+			SIG_OVERFLOW1();
+			frame += BENCH_FRAME;
+			benchWait(&newFrame, start, reads);
+
+		}//end else
+
+	}//end while
+
+	printf("TCNT1 waits over %lld s, us, with interrupts off\n", BENCH_RUN_US / 1000000);
+	printf("  %-22s %8s %8s %9s %9s %9s\n", "ISR", "worst", "mean", "waited", "runs", "reads");
+	benchPrint("old 1 ms tick mover", &oldTick);
+	benchPrint("new tick", &newTick);
+	benchPrint("new frame", &newFrame);
+	benchPrint("new pulse end compare", &newCompare);
+
+	if( newTick.Reads || newFrame.Reads || newCompare.Reads ){
+		printf("  FAIL: the new path reads TCNT1\n");
+		fail++;
+	}//end if
+
+	//Software PWM pulse ends, on time and with every wake held up
+	benchWake(0, &wakeWait, &wakeLate);
+	benchWake(BENCH_HOLD_US, &heldWait, &heldLate);
+	printf("software PWM wakes, us: longest SIG_OVERFLOW0 wait from entry, latest pulse end\n");
+	printf("  on time               %8lld %8lld\n", (long long)wakeWait, (long long)wakeLate);
+	printf("  held up %2d us         %8lld %8lld\n", BENCH_HOLD_US, (long long)heldWait, (long long)heldLate);
+	if( wakeWait > BENCH_SW_WAIT || heldWait > BENCH_SW_WAIT ){
+		printf("  FAIL: SIG_OVERFLOW0 waits more than PWM_SW_LEAD and a us per pulse end\n");
+		fail++;
+	}//end if
+	if( wakeLate > 2 * BENCH_READ_US ){
+		printf("  FAIL: an on time wake ends a pulse late\n");
+		fail++;
+	}//end if
+	if( heldLate > BENCH_HOLD_US + BENCH_ENTRY_US + BENCH_READ_US ){
+		printf("  FAIL: a held up wake ends a pulse later than the hold-up\n");
+		fail++;
+	}//end if
+
+	printf("%d failures\n", fail);
+
+	return fail ? 1 : 0;
+
+}//end main
@@ -0,0 +1,210 @@
+/*	File:	latencybench.c
+*	Desc:	Host benchmark of the command to pulse latency at each
+*			frame rate, and check that a long fast move is not cut
+*			short by the plan length.
+*	Proj:	AutoMotion
+*
+*	NOTES:
+*
+*		A command is taken by motionService() in the main loop and
+*	planned to start on the next frame.  The frame ISR writes the first
+*	new duty, which Timer1 double buffers, so the first changed pulse
+*	is one frame after it.  The command lands anywhere in a frame, so it
+*	waits up to a frame, half on average, for the ISR.  The latency is
+*	printed for a 20 us nudge and a PWM_CLOSED_DFLT to PWM_OPEN_DFLT
+*	move at Speed 0, to the first changed pulse and to the pulse at the
+*	target.  The time to plan on the part is not in it, that needs the
+*	part or a simulator; the host time per plan only shows how it grows.
+*
+*		The truncation check moves PWM_CLSD_LIM to PWM_OPEN_LIM and
+*	back at Speed 32 to 63 for each frame rate.  It fails if any frame
+*	steps more than twice the step across the middle, the jump a plan
+*	cut short by its frame limit lands with.
+*/
+
+#include <stdio.h>
+#include <time.h>
+#include "includes.h"
+
+static uint16_t		BenchDuty;
+static uint8_t		BenchOut;
+static int			BenchFail;
+
+void SetPWMDuty(uint8_t ch, uint16_t duty){
+
+	if( !ch )
+		BenchDuty = duty;
+
+}//end SetPWMDuty
+
+void SetPWMOutput(uint8_t ch, bool on){
+
+	if( on )
+		BenchOut |= 1<<ch;
+	else
+		BenchOut &= ~(1<<ch);
+
+}//end SetPWMOutput
+
+bool GetPWMOutput(uint8_t ch){
+
+	return ( BenchOut>>ch ) & 1;
+
+}//end GetPWMOutput
+
+#include "../Source/motion.c"
+
+static double benchNow(void){
+
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+
+}//end benchNow
+
+static void benchSetup(uint16_t frameUs, uint16_t speed, uint16_t duty){
+
+	//Local variables
+	uint8_t		ch;
+	uint16_t	d;
+
+	motionInit(duty);
+	motionSetFrame(frameUs);
+	motionSetSpeed(speed);
+	while( motionGetEvent(&ch, &d) );
+	BenchDuty = duty;
+
+}//end benchSetup
+
+static void benchLatency(uint16_t frameUs, uint16_t from, uint16_t to, double *ns){
+/*	Desc:		Moves channel 0 and prints the latency to the first
+*				changed pulse and to the pulse at the target.
+*	Args:		frameUs, frame length, x 1 us.
+*				from, to, duty, x 1 us.
+*				ns, host time to plan added to it.
+*	Ret:		None.
+*/
+
+	//Local variables
+	uint32_t	first	= 0;
+	uint32_t	frames	= 0;
+	double		t;
+
+	benchSetup(frameUs, 0, from);
+
+	t = benchNow();
+	motionMoveTo(0, to, MOTION_PROFILE_TRAP);
+	motionService();
+	*ns += benchNow() - t;
+
+	while( BenchDuty != to ){
+		motionFrame();
+		frames++;
+		if( !first && BenchDuty != from )
+			first = frames;
+	}//end while
+
+	//Wait for the ISR, frames to the duty write, and the double buffer
+	printf(" %7.1f %7.1f %7.1f",
+		( 0.5 + first ) * frameUs / 1000, ( 1.0 + first ) * frameUs / 1000,
+		( 1.0 + frames ) * frameUs / 1000);
+
+}//end benchLatency
+
+static void benchTruncate(uint16_t frameUs, uint16_t speed, double *ns){
+/*	Desc:		Runs the truncation check for one frame rate and Speed.
+*	Args:		frameUs, frame length, x 1 us.
+*				speed, as SERVO_PARAMS Speed.
+*				ns, host time to plan added to it.
+*	Ret:		None.
+*/
+
+	//Local variables
+	static const uint16_t	duty[] = { PWM_OPEN_LIM, PWM_CLSD_LIM };
+	uint32_t	mid;
+	uint32_t	pos;
+	int32_t		step;
+	int32_t		cruise;
+	int32_t		worst;
+	uint8_t		i;
+	uint8_t		ch;
+	uint16_t	d;
+	double		t;
+
+	mid = ((uint32_t)(PWM_OPEN_LIM + PWM_CLSD_LIM)<<MOTION_PLAN_SHIFT) / 2;
+	benchSetup(frameUs, speed, PWM_CLSD_LIM);
+
+	for( i = 0; i < 2; i++ ){
+
+		cruise	= 0;
+		worst	= 0;
+
+		t = benchNow();
+		motionMoveTo(0, duty[i], MOTION_PROFILE_TRAP);
+		motionService();
+		*ns += benchNow() - t;
+
+		while( motionBusy(0) ){
+
+			pos = MotionCh[0].Pos;
+			motionFrame();
+			step = (int32_t)(MotionCh[0].Pos - pos);
+			if( step < 0 )
+				step = -step;
+			if( ( pos < mid ) != ( MotionCh[0].Pos < mid ) )
+				cruise = step;
+			if( step > worst )
+				worst = step;
+
+		}//end while
+		while( motionGetEvent(&ch, &d) );
+
+		if( !cruise || worst > 2 * cruise ){
+			if( BenchFail++ < 5 )
+				printf("  FAIL: %u Hz, Speed %u, to %u us: step of %.2f us, cruise %.2f us\n",
+					1000000U / frameUs, speed, duty[i],
+					(double)worst / (1<<MOTION_PLAN_SHIFT), (double)cruise / (1<<MOTION_PLAN_SHIFT));
+		}//end if
+
+	}//end for
+
+}//end benchTruncate
+
+int main(void){
+
+	//Local variables
+	static const uint16_t	frameUs[]	= { 20000, 5000, 3000 };
+	uint8_t		f;
+	uint16_t	s;
+	uint16_t	plans;
+	double		ns;
+
+	printf("latency, ms: average and worst to the first changed pulse, worst to the target\n");
+	printf("%6s %23s %23s %10s\n", "rate", "20 us nudge", "500 us move", "plan ns");
+	for( f = 0; f < 3; f++ ){
+
+		ns = 0;
+		printf("%3u Hz", 1000000U / frameUs[f]);
+		benchLatency(frameUs[f], 1500, 1520, &ns);
+		benchLatency(frameUs[f], PWM_CLOSED_DFLT, PWM_OPEN_DFLT, &ns);
+		printf(" %10.0f\n", ns / 2);
+
+	}//end for
+
+	printf("\ntruncation: %u to %u us and back, Speed 32 to 63\n", PWM_CLSD_LIM, PWM_OPEN_LIM);
+	for( f = 0; f < 3; f++ ){
+
+		ns		= 0;
+		plans	= 0;
+		for( s = 32; s < 64; s++, plans += 2 )
+			benchTruncate(frameUs[f], s, &ns);
+		printf("  %3u Hz: %.0f host ns per plan\n", 1000000U / frameUs[f], ns / plans);
+
+	}//end for
+
+	printf("%d failures\n", BenchFail);
+
+	return BenchFail ? 1 : 0;
+
+}//end main
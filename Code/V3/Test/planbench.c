@@ -0,0 +1,250 @@
+/*	File:	planbench.c
+*	Desc:	Host benchmark and check of how motion.c hands a new
+*			plan to the frame ISR.
+*	Proj:	AutoMotion
+*
+*	NOTES:
+*
+*		On the part the ISR keeps running frames while a plan is worked
+*	out.  Here the frames are run from stubSei() when the planner turns
+*	interrupts back on after taking the servo's position, the second
+*	sei() in motionService() for one channel, so the plan is worked
+*	out "late" by a set number of frames.
+*
+*		The retarget check moves 1000 to 2000 us and, a third of the
+*	way, sends the servo back to 1250 or on to 2250, for each frame
+*	rate, Speed 0 and 4 and a lag of 0 to 6 frames.  It reports the
+*	largest change in step from one frame to the next, which for a
+*	trapezoid is the acceleration plus what joining frames into
+*	segments adds, and fails if a lag makes it more than twice what it
+*	is with no lag.
+*
+*		The event check starts a short move and sends the next one on
+*	every frame of it, with a lag long enough for the first to arrive
+*	while the second is worked out.  Every command must get exactly one
+*	event.
+*/
+
+#define STUB_SEI_FUNC
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "includes.h"
+
+static uint16_t		BenchDuty[PWM_CH_NUM];
+static uint8_t		BenchOut;
+
+void SetPWMDuty(uint8_t ch, uint16_t duty){
+
+	BenchDuty[ch] = duty;
+
+}//end SetPWMDuty
+
+void SetPWMOutput(uint8_t ch, bool on){
+
+	if( on )
+		BenchOut |= 1<<ch;
+	else
+		BenchOut &= ~(1<<ch);
+
+}//end SetPWMOutput
+
+bool GetPWMOutput(uint8_t ch){
+
+	return ( BenchOut>>ch ) & 1;
+
+}//end GetPWMOutput
+
+#include "../Source/motion.c"
+
+//sei() calls left before the lag frames run, and the lag
+static uint8_t		BenchSeiLeft;
+static uint8_t		BenchLag;
+//Position, x 1 us Q7, of the last two frames, and the worst change in step
+static int32_t		BenchPos[2];
+static int32_t		BenchWorst;
+static uint32_t		BenchFrames;
+
+static void benchFrame(void){
+
+	//Local variables
+	int32_t		pos;
+	int32_t		dv;
+
+	motionFrame();
+	BenchFrames++;
+
+	pos	= MotionCh[0].Pos;
+	dv	= (pos - BenchPos[1]) - (BenchPos[1] - BenchPos[0]);
+	if( dv < 0 )
+		dv = -dv;
+	if( BenchFrames > 2 && dv > BenchWorst )
+		BenchWorst = dv;
+	BenchPos[0] = BenchPos[1];
+	BenchPos[1] = pos;
+
+}//end benchFrame
+
+void stubSei(void){
+
+	SREG |= 0x80;
+
+	if( BenchLag && BenchSeiLeft && !--BenchSeiLeft ){
+		while( BenchLag ){
+			BenchLag--;
+			benchFrame();
+		}//end while
+	}//end if
+
+}//end stubSei
+
+static void benchService(void){
+}//end benchService
+
+static void benchSetup(uint16_t frameUs, uint16_t speed, uint16_t duty){
+
+	uint8_t		ch;
+	uint16_t	d;
+
+	motionInit(duty);
+	motionSetService(benchService);
+	motionSetFrame(frameUs);
+	motionSetSpeed(speed);
+	while( motionGetEvent(&ch, &d) );
+
+	BenchPos[0]		= (int32_t)duty<<MOTION_PLAN_SHIFT;
+	BenchPos[1]		= BenchPos[0];
+	BenchWorst		= 0;
+	BenchFrames		= 0;
+
+}//end benchSetup
+
+static void benchCmd(uint16_t duty, uint8_t lag){
+
+	motionMoveTo(0, duty, MOTION_PROFILE_TRAP);
+	BenchLag		= lag;
+	BenchSeiLeft	= PWM_CH_NUM + 1;
+	motionService();
+	BenchLag		= 0;
+
+}//end benchCmd
+
+static int benchRetarget(void){
+/*	Desc:		Runs the retarget check.
+*	Ret:		Number of failures.
+*/
+
+	//Local variables
+	static const uint16_t	frameUs[]	= { 20000, 5000, 3000 };
+	static const uint16_t	speeds[]	= { 0, 4 };
+	static const uint16_t	second[]	= { 1250, 2250 };
+	uint8_t		f;
+	uint8_t		s;
+	uint8_t		t;
+	uint8_t		lag;
+	int32_t		worst;
+	int32_t		limit	= 0;
+	int			fail = 0;
+
+	printf("retarget: worst step change, x 1 us / frame, for a lag of 0 to 6 frames\n");
+	for( f = 0; f < 3; f++ ){
+		for( s = 0; s < 2; s++ ){
+
+			benchSetup(frameUs[f], speeds[s], 1000);
+			printf("  %3u Hz, Speed %u, accel %6.2f:", 1000000U / frameUs[f], speeds[s],
+				(double)MotionAccel / (1UL<<MOTION_SHIFT));
+
+			for( lag = 0; lag <= 6; lag++ ){
+
+				worst = 0;
+				for( t = 0; t < 2; t++ ){
+
+					benchSetup(frameUs[f], speeds[s], 1000);
+					benchCmd(2000, 0);
+					while( MotionCh[0].Pos < (1333UL<<MOTION_PLAN_SHIFT) )
+						benchFrame();
+					benchCmd(second[t], lag);
+					while( motionBusy(0) )
+						benchFrame();
+					if( BenchWorst > worst )
+						worst = BenchWorst;
+
+				}//end for
+
+				printf(" %6.2f", (double)worst / (1<<MOTION_PLAN_SHIFT));
+				if( !lag )
+					limit = worst * 2;
+				else if( worst > limit )
+					fail++;
+
+			}//end for
+			printf("\n");
+
+		}//end for
+	}//end for
+
+	return fail;
+
+}//end benchRetarget
+
+static int benchEvents(void){
+/*	Desc:		Runs the event check.
+*	Ret:		Number of commands without exactly one event.
+*/
+
+	//Local variables
+	uint16_t		at;
+	uint16_t		frames;
+	uint16_t		i;
+	uint8_t			ch;
+	uint16_t		duty;
+	uint8_t			got[2];
+	MOTION_EVENT	event;
+	int				fail = 0;
+
+	//Frames the short move takes
+	benchSetup(3000, 0, 1500);
+	benchCmd(1560, 0);
+	for( frames = 0; motionBusy(0); frames++ )
+		benchFrame();
+
+	for( at = 0; at <= frames; at++ ){
+
+		benchSetup(3000, 0, 1500);
+		got[0] = got[1] = 0;
+
+		benchCmd(1560, 0);
+		for( i = 0; i < at; i++ )
+			benchFrame();
+		benchCmd(1000, 6);
+
+		for( i = 0; i < 2000; i++ ){
+			benchFrame();
+			motionService();
+			while( (event = motionGetEvent(&ch, &duty)) != MOTION_EVENT_NONE )
+				got[ duty == 1000 ]++;
+		}//end for
+
+		if( got[0] != 1 || got[1] != 1 ){
+			if( fail++ < 5 )
+				printf("  FAIL: second command on frame %u: %u and %u events\n", at, got[0], got[1]);
+		}//end if
+
+	}//end for
+
+	printf("events: second command on each of %u frames, lag 6, %d without exactly one event\n", frames + 1, fail);
+	return fail;
+
+}//end benchEvents
+
+int main(void){
+
+	//Local variables
+	int		fail;
+
+	fail  = benchRetarget();
+	fail += benchEvents();
+
+	return fail ? 1 : 0;
+
+}//end main
@@ -0,0 +1,210 @@
+/*	File:	swpwmbench.c
+*	Desc:	Host check of the software PWM pulse ends in
+*			InputOutput.c against a model of TOC0 and TOC1.
+*	Proj:	AutoMotion
+*
+*	NOTES:
+*
+*		The model counts CPU clocks.  TOC1 and TOC0 count us off the
+*	same prescaler, TCNT1 from the frame start.  PWMFrameStart() runs
+*	5 us into the frame, and SIG_OVERFLOW0 4 us after each TOC0
+*	overflow, the ISR entry, or with one in 8 held up a further 0 to
+*	60 us by another ISR.  Each TCNT1 read in the ISR is 1 us, the
+*	wait loop, and a pin is taken to go low when the read after the
+*	PORTD write starts.
+*
+*		Channels 2 and 3 get pseudo random pulses of 750 to 2250 us,
+*	some the same and some a few us apart, for 10000 frames.  It reports
+*	the longest SIG_OVERFLOW0 run, with interrupts off, from the
+*	overflow, and how late the pulse ends are against the ends
+*	PWMFrameStart() worked out.  It fails if an end is early, or an ISR
+*	that wasn't held up ends a pulse more than 2 us late or runs longer
+*	than BENCH_RUN_MAX, the entry and PWM_SW_LEAD and a us for each end.
+*	Two ends closer than that are both waited out in one run.
+*/
+
+#define PWM_CH_NUM			4
+#define STUB_TCNT1_FUNC
+
+#include <stdio.h>
+#include "includes.h"
+
+void timerInit(void){
+}//end timerInit
+
+void a2dInit(void){
+}//end a2dInit
+
+void motionInit(uint16_t duty){
+
+	(void)duty;
+
+}//end motionInit
+
+uint16_t a2dGetSample(uint8_t channel){
+
+	(void)channel;
+	return 0;
+
+}//end a2dGetSample
+
+uint16_t a2dGetSampleTime(uint8_t channel, uint32_t *us){
+
+	(void)channel;
+	*us = 0;
+	return 0;
+
+}//end a2dGetSampleTime
+
+#define BENCH_CLK_US	8
+#define BENCH_ENTRY		(4 * BENCH_CLK_US)
+#define BENCH_FRAMES	10000
+#define BENCH_RUN_MAX	( BENCH_ENTRY + PWM_SW_NUM * ( PWM_SW_LEAD / PWM_US(1) + 1 ) * BENCH_CLK_US )
+
+static int64_t		BenchClk;		//now, CPU clocks
+static int64_t		BenchFrame;		//frame started
+static uint8_t		BenchPins;		//PORTD pins at the last read
+static int64_t		BenchEdge[2];	//when each pin went low, -1 if not yet
+static uint32_t		BenchSeed = 1;
+
+static void benchPins(void){
+
+	//Local variables
+	uint8_t		i;
+
+	for( i = 0; i < 2; i++ ){
+		if( ( BenchPins & ~PORTD ) & ( 1<<(PD6 + i) ) )
+			BenchEdge[i] = BenchClk;
+	}//end for
+	BenchPins = PORTD & PWM_SW_PINS;
+
+}//end benchPins
+
+uint16_t stubTcnt1(void){
+
+	benchPins();
+	BenchClk += BENCH_CLK_US;
+
+	return ( BenchClk - BenchFrame ) / BENCH_CLK_US;
+
+}//end stubTcnt1
+
+#include "../Source/InputOutput.c"
+
+static uint32_t benchRand(uint32_t range){
+
+	BenchSeed = BenchSeed * 1103515245UL + 12345;
+	return (BenchSeed>>8) % range;
+
+}//end benchRand
+
+static int64_t benchOverflow(void){
+/*	Desc:		Works out when TOC0 overflows after a write.
+*	Ret:		CPU clock of the overflow.
+*/
+
+	//The next count is on the prescaler, in step with TOC1
+	return BenchFrame + ( ( BenchClk - BenchFrame ) / BENCH_CLK_US + 256 - TCNT0 ) * BENCH_CLK_US;
+
+}//end benchOverflow
+
+int main(void){
+
+	//Local variables
+	uint32_t	f;
+	uint8_t		i;
+	uint16_t	duty[2];
+	uint16_t	end[2];
+	uint8_t		j;
+	int64_t		wake;
+	int64_t		entry;
+	int64_t		late;
+	int64_t		run;
+	int64_t		runMost		= 0;
+	int64_t		runHeld		= 0;
+	int64_t		lateMost	= 0;
+	int64_t		lateHeld	= 0;
+	uint32_t	wakes		= 0;
+	bool		held;
+	int			fail		= 0;
+
+	SetPWMOutput(2, TRUE);
+	SetPWMOutput(3, TRUE);
+
+	for( f = 0; f < BENCH_FRAMES; f++ ){
+
+		duty[0] = 750 + benchRand(1501);
+		switch( benchRand(4) ){
+			case 0:		duty[1] = duty[0];						break;
+			case 1:		duty[1] = duty[0] + benchRand(8);		break;
+			default:	duty[1] = 750 + benchRand(1501);		break;
+		}//end switch
+		SetPWMDuty(2, PWM_US(duty[0]));
+		SetPWMDuty(3, PWM_US(duty[1]));
+
+		BenchFrame		= (int64_t)f * TOC1_FRAME_US * BENCH_CLK_US;
+		BenchClk		= BenchFrame + 5 * BENCH_CLK_US;
+		BenchEdge[0]	= BenchEdge[1] = -1;
+		PWMFrameStart();
+		BenchPins		= PORTD & PWM_SW_PINS;
+		for( j = 0; j < PwmSwEdges; j++ ){
+			for( i = 0; i < 2; i++ )
+				if( PwmSwMask[j] & ( 1<<(PD6 + i) ) )
+					end[i] = PwmSwEnd[j];
+		}//end for
+
+		while( TCCR0 ){
+
+			//Overflow, the ISR entry, and sometimes another ISR first
+			wake	= benchOverflow();
+			entry	= wake + BENCH_ENTRY;
+			held	= !benchRand(8);
+			if( held )
+				entry += benchRand(61) * BENCH_CLK_US;
+			BenchClk = entry;
+			SIG_OVERFLOW0();
+			benchPins();
+			wakes++;
+
+			run = BenchClk - wake;
+			if( held && run > runHeld )
+				runHeld = run;
+			else if( !held && run > runMost )
+				runMost = run;
+			if( !held && run > BENCH_RUN_MAX ){
+				if( fail++ < 5 )
+					printf("  FAIL: frame %lu, SIG_OVERFLOW0 ran %lld us\n",
+						(unsigned long)f, (long long)(run / BENCH_CLK_US));
+			}//end if
+
+			//Pulse ends this run, against the time asked for
+			for( i = 0; i < 2; i++ ){
+
+				if( BenchEdge[i] < 0 || BenchEdge[i] < entry )
+					continue;
+				late = ( BenchEdge[i] - BenchFrame ) / BENCH_CLK_US - end[i];
+				if( held && late > lateHeld )
+					lateHeld = late;
+				else if( !held && late > lateMost )
+					lateMost = late;
+				if( late < 0 || ( !held && late > 2 ) ){
+					if( fail++ < 5 )
+						printf("  FAIL: frame %lu, channel %u ended %lld us late\n",
+							(unsigned long)f, i + 2, (long long)late);
+				}//end if
+
+			}//end for
+
+		}//end while
+
+	}//end for
+
+	printf("%lu wakes over %u frames, ISR from overflow to return / pulse end late, us:\n",
+		(unsigned long)wakes, BENCH_FRAMES);
+	printf("  on time:   %3lld / %3lld\n", (long long)(runMost / BENCH_CLK_US), (long long)lateMost);
+	printf("  held up:   %3lld / %3lld\n", (long long)(runHeld / BENCH_CLK_US), (long long)lateHeld);
+	printf("%d failures\n", fail);
+
+	return fail ? 1 : 0;
+
+}//end main
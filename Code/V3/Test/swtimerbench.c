@@ -0,0 +1,224 @@
+/*	File:	swtimerbench.c
+*	Desc:	Host benchmark and check of the timer wheel in
+*			swtimer.c.
+*	Proj:	AutoMotion
+*
+*	NOTES:
+*
+*		MS_TIMER is replaced by a counter the benchmark steps 1 ms at a
+*	time.  The check starts a timer at every start time in a wheel cycle
+*	for timeouts up to past the level 1 range and fails if any expires
+*	early or a wheel tick or more late.
+*
+*		The benchmark keeps N timers running, each restarted from its
+*	expiry function with a pseudo random timeout of 16 ms to 6 s, and
+*	calls swtimerService() every ms for 10 minutes.  It reports the work
+*	per wheel tick, timers expired and timers moved down a level, and
+*	the host time per call, against a loop that compares every timeout
+*	on every call the way main.c used to.  Only the work counts carry
+*	over to the part; the host times just show how each one grows.
+*/
+
+#include <stdio.h>
+#include <time.h>
+#include "includes.h"
+
+static uint32_t		BenchMs;
+
+uint32_t timerGetMs(void){
+
+	return BenchMs;
+
+}//end timerGetMs
+
+#include "../Source/swtimer.c"
+
+#define BENCH_MAX		256
+#define BENCH_RUN_MS	600000UL
+
+static SWTIMER		BenchTimer[BENCH_MAX];
+static uint32_t		BenchDue[BENCH_MAX];
+static uint32_t		BenchFired;
+static uint32_t		BenchExpired;
+static bool			BenchRestarted[BENCH_MAX];
+static uint32_t		BenchSeed = 1;
+
+static uint32_t benchRand(uint32_t range){
+
+	BenchSeed = BenchSeed * 1103515245UL + 12345;
+	return (BenchSeed>>8) % range;
+
+}//end benchRand
+
+static double benchNow(void){
+
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+
+}//end benchNow
+
+static void benchOnce(void *arg){
+
+	(void)arg;
+	BenchFired = BenchMs;
+
+}//end benchOnce
+
+static void benchRestart(void *arg){
+
+	SWTIMER		*timer = arg;
+
+	BenchExpired++;
+	BenchRestarted[timer - BenchTimer] = TRUE;
+	swtimerStart(timer, 16 + benchRand(6000), benchRestart, timer);
+
+}//end benchRestart
+
+static uint8_t benchLevel(const SWTIMER *timer){
+/*	Desc:		Finds the wheel level a running timer is in.
+*	Args:		timer, running timer.
+*	Ret:		0 or 1.
+*	Notes:		Next is the first member, so a link that is not a slot
+*				head is the timer in front.
+*/
+
+	//Local variables
+	SWTIMER		**link = timer->Pprev;
+
+	while(		( link < &SwtimerWheel0[0] || link >= &SwtimerWheel0[SWTIMER_SLOTS] )
+			&&	( link < &SwtimerWheel1[0] || link >= &SwtimerWheel1[SWTIMER_SLOTS] ) )
+		link = ((SWTIMER *)link)->Pprev;
+
+	return ( link >= &SwtimerWheel1[0] && link < &SwtimerWheel1[SWTIMER_SLOTS] );
+
+}//end benchLevel
+
+static int benchLate(void){
+/*	Desc:		Checks that every timer expires within a wheel tick
+*				after its timeout.
+*	Ret:		Number of failures.
+*/
+
+	//Local variables
+	uint32_t	start;
+	uint32_t	ms;
+	int32_t		late;
+	int32_t		worst	= -1;
+	int			fail	= 0;
+	SWTIMER		timer	= { 0 };
+
+	for( start = 0; start < (1UL<<(SWTIMER_SHIFT + SWTIMER_SLOT_SHIFT)) + 7; start += 3 ){
+		for( ms = 1; ms < 5000; ms += 7 ){
+
+			BenchMs		= start;
+			BenchFired	= 0;
+			swtimerInit();
+			swtimerStart(&timer, ms, benchOnce, NULL);
+
+			while( !BenchFired ){
+				BenchMs++;
+				swtimerService();
+			}//end while
+
+			late = BenchFired - (start + ms);
+			if( late > worst )
+				worst = late;
+			if( late < 0 || late >= (1<<SWTIMER_SHIFT) ){
+				if( fail++ < 5 )
+					printf("  FAIL: started at %lu for %lu ms, expired %ld ms late\n",
+						(unsigned long)start, (unsigned long)ms, (long)late);
+			}//end if
+
+		}//end for
+	}//end for
+
+	printf("expiry: worst %ld ms late, limit %d ms, %d failures\n", (long)worst, (1<<SWTIMER_SHIFT) - 1, fail);
+	return fail;
+
+}//end benchLate
+
+static void benchCost(uint16_t num){
+/*	Desc:		Runs num timers and prints the work per wheel tick.
+*	Args:		num, timers running.
+*	Ret:		None.
+*/
+
+	//Local variables
+	uint16_t	i;
+	uint32_t	ticks	= 0;
+	uint32_t	expired	= 0;
+	uint32_t	moved	= 0;
+	uint32_t	worst	= 0;
+	uint32_t	work;
+	double		t;
+	double		wheelNs	= 0;
+	double		pollNs	= 0;
+	uint8_t		level[BENCH_MAX];
+
+	BenchMs		= 0;
+	BenchSeed	= num;
+	swtimerInit();
+	for( i = 0; i < num; i++ ){
+		swtimerStart(&BenchTimer[i], 16 + benchRand(6000), benchRestart, &BenchTimer[i]);
+		BenchDue[i] = BenchTimer[i].Expire<<SWTIMER_SHIFT;
+	}//end for
+
+	for( BenchMs = 1; BenchMs <= BENCH_RUN_MS; BenchMs++ ){
+
+		for( i = 0; i < num; i++ ){
+			level[i]			= benchLevel(&BenchTimer[i]);
+			BenchRestarted[i]	= FALSE;
+		}//end for
+		BenchExpired = 0;
+
+		t = benchNow();
+		swtimerService();
+		wheelNs += benchNow() - t;
+
+		//The same number of timeouts, compared one by one on every call
+		t = benchNow();
+		for( i = 0; i < num; i++ ){
+			if( (int32_t)(BenchMs - BenchDue[i]) >= 0 )
+				BenchDue[i] = BenchMs + 16 + benchRand(6000);
+		}//end for
+		pollNs += benchNow() - t;
+
+		//Work done: expiries, and timers moved down from level 1
+		work = BenchExpired;
+		for( i = 0; i < num; i++ ){
+			if( !BenchRestarted[i] && level[i] && !benchLevel(&BenchTimer[i]) )
+				work++, moved++;
+		}//end for
+		expired += BenchExpired;
+		if( work > worst )
+			worst = work;
+		if( !(BenchMs & ((1<<SWTIMER_SHIFT) - 1)) )
+			ticks++;
+
+	}//end for
+
+	printf("%6u %12.3f %12.3f %10lu %12.1f %12.1f\n", num,
+		(double)expired / ticks, (double)moved / ticks, (unsigned long)worst,
+		wheelNs / BENCH_RUN_MS, pollNs / BENCH_RUN_MS);
+
+}//end benchCost
+
+int main(void){
+
+	//Local variables
+	static const uint16_t	nums[] = { 1, 4, 16, 64, 256 };
+	uint8_t					i;
+	int						fail;
+
+	fail = benchLate();
+
+	printf("\ncost over %lu s, 1 call per ms:\n", BENCH_RUN_MS / 1000);
+	printf("%6s %12s %12s %10s %12s %12s\n", "timers", "expired/tick", "moved/tick", "worst/tick", "wheel ns", "poll ns");
+	for( i = 0; i < sizeof(nums) / sizeof(nums[0]); i++ )
+		benchCost(nums[i]);
+
+	return fail ? 1 : 0;
+
+}//end main
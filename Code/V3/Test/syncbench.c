@@ -0,0 +1,292 @@
+/*	File:	syncbench.c
+*	Desc:	Host check of the synchronized moves in motion.c.
+*	Proj:	AutoMotion
+*
+*	NOTES:
+*
+*		Two channels.  The frames are run one at a time and the planner
+*	runs between them, so every plan is ready on time.  For each channel
+*	it takes the largest change in step from one frame to the next, and
+*	the frame it arrives on.
+*
+*		The retarget check moves both channels from 1000 us, channel 0 to
+*	2000 and channel 1 to 1500, and a third of the way sends them on to
+*	new targets, for each frame rate and Speed 0 and 4.  Some of them
+*	turn a channel back, and some make the other channel the lead.  It is
+*	run with each channel sent on its own with motionMoveTo(), and then
+*	with the group sent with motionMoveSync().  It fails if the group's
+*	step changes by more than twice the most it does on its own, the
+*	channels don't arrive on the same frame, or not at their targets.
+*
+*		The zero length lead check plans channel 1, moving, to follow
+*	channel 0, which is holding at its target, so the lead's plan is
+*	empty.  It fails if channel 1 doesn't get to its target, or its step
+*	changes by more than it does sent there on its own.
+*/
+
+#include <stdio.h>
+
+#define PWM_CH_NUM			2
+
+#include "includes.h"
+
+static uint8_t		BenchOut;
+
+void SetPWMDuty(uint8_t ch, uint16_t duty){
+
+	(void)ch;
+	(void)duty;
+
+}//end SetPWMDuty
+
+void SetPWMOutput(uint8_t ch, bool on){
+
+	if( on )
+		BenchOut |= 1<<ch;
+	else
+		BenchOut &= ~(1<<ch);
+
+}//end SetPWMOutput
+
+bool GetPWMOutput(uint8_t ch){
+
+	return ( BenchOut>>ch ) & 1;
+
+}//end GetPWMOutput
+
+#include "../Source/motion.c"
+
+//Position, x 1 us Q7, of the last two frames, the worst change in step
+//	and the frame each channel arrived on, per channel
+static int32_t		BenchPos[PWM_CH_NUM][2];
+static int32_t		BenchWorst[PWM_CH_NUM];
+static uint32_t		BenchArrive[PWM_CH_NUM];
+static uint32_t		BenchFrames;
+
+static void benchFrame(void){
+
+	//Local variables
+	int32_t		pos;
+	int32_t		dv;
+	uint8_t		ch;
+	uint16_t	duty;
+
+	motionFrame();
+	BenchFrames++;
+
+	for( ch = 0; ch < PWM_CH_NUM; ch++ ){
+
+		pos	= MotionCh[ch].Pos;
+		dv	= (pos - BenchPos[ch][1]) - (BenchPos[ch][1] - BenchPos[ch][0]);
+		if( dv < 0 )
+			dv = -dv;
+		if( BenchFrames > 2 && dv > BenchWorst[ch] )
+			BenchWorst[ch] = dv;
+		BenchPos[ch][0] = BenchPos[ch][1];
+		BenchPos[ch][1] = pos;
+
+		if( !BenchArrive[ch] && !motionBusy(ch) )
+			BenchArrive[ch] = BenchFrames;
+
+	}//end for
+
+	motionService();
+	while( motionGetEvent(&ch, &duty) );
+
+}//end benchFrame
+
+static void benchSetup(uint16_t frameUs, uint16_t speed, uint16_t duty){
+
+	//Local variables
+	uint8_t		ch;
+	uint16_t	d;
+
+	motionInit(duty);
+	motionSetFrame(frameUs);
+	motionSetSpeed(speed);
+	while( motionGetEvent(&ch, &d) );
+
+	for( ch = 0; ch < PWM_CH_NUM; ch++ ){
+		BenchPos[ch][0]	= (int32_t)duty<<MOTION_PLAN_SHIFT;
+		BenchPos[ch][1]	= BenchPos[ch][0];
+		BenchWorst[ch]	= 0;
+	}//end for
+	BenchFrames = 0;
+
+}//end benchSetup
+
+static void benchSync(const uint16_t *duty){
+/*	Desc:		Sends the group to its targets and runs it until both
+*				arrive.
+*/
+
+	BenchArrive[0] = BenchArrive[1] = 0;
+	motionMoveSync(duty, MOTION_PROFILE_TRAP);
+	motionService();
+	while( motionBusy(0) || motionBusy(1) )
+		benchFrame();
+
+}//end benchSync
+
+static int32_t benchMost(void){
+
+	return ( BenchWorst[0] > BenchWorst[1] ) ? BenchWorst[0] : BenchWorst[1];
+
+}//end benchMost
+
+static void benchRetargetRun(uint16_t frameUs, uint16_t speed, const uint16_t *duty, bool sync){
+/*	Desc:		Starts the group move, and a third of the way sends the
+*				channels on to new targets, together or each on its
+*				own, and runs them until both arrive.
+*/
+
+	//Local variables
+	static const uint16_t	first[]	= { 2000, 1500 };
+	uint8_t		ch;
+	
+	benchSetup(frameUs, speed, 1000);
+	motionMoveSync(first, MOTION_PROFILE_TRAP);
+	motionService();
+	while( MotionCh[0].Pos < (1333UL<<MOTION_PLAN_SHIFT) )
+		benchFrame();
+	
+	if( sync ){
+		benchSync(duty);
+		return;
+	}//end if
+	
+	BenchArrive[0] = BenchArrive[1] = 0;
+	for( ch = 0; ch < PWM_CH_NUM; ch++ )
+		motionMoveTo(ch, duty[ch], MOTION_PROFILE_TRAP);
+	motionService();
+	while( motionBusy(0) || motionBusy(1) )
+		benchFrame();
+
+}//end benchRetargetRun
+
+static int benchRetarget(void){
+/*	Desc:		Runs the retarget check.
+*	Ret:		Number of failures.
+*/
+
+	//Local variables
+	static const uint16_t	frameUs[]	= { 20000, 5000, 3000 };
+	static const uint16_t	speeds[]	= { 0, 4 };
+	static const uint16_t	second[][2]	= { { 1250, 1900 }, { 2250, 1100 }, { 1800, 1200 }, { 1100, 2250 } };
+	uint8_t		f;
+	uint8_t		s;
+	uint8_t		t;
+	int32_t		own;
+	int32_t		worst;
+	int32_t		skew;
+	int			fail	= 0;
+	
+	printf("retarget: worst step change, x 1 us / frame, each channel on its own and the group, arrival skew in frames\n");
+	for( f = 0; f < 3; f++ ){
+		for( s = 0; s < 2; s++ ){
+		
+			printf("  %3u Hz, Speed %u:", 1000000U / frameUs[f], speeds[s]);
+			for( t = 0; t < sizeof(second) / sizeof(second[0]); t++ ){
+			
+				benchRetargetRun(frameUs[f], speeds[s], second[t], FALSE);
+				own = benchMost();
+				benchRetargetRun(frameUs[f], speeds[s], second[t], TRUE);
+				worst	= benchMost();
+				skew	= (int32_t)BenchArrive[1] - (int32_t)BenchArrive[0];
+				
+				printf("  %5.2f %5.2f %+ld", (double)own / (1<<MOTION_PLAN_SHIFT),
+					(double)worst / (1<<MOTION_PLAN_SHIFT), (long)skew);
+				if(		worst > 2 * own || skew
+					||	MotionCh[0].Pos != (uint32_t)second[t][0]<<MOTION_PLAN_SHIFT
+					||	MotionCh[1].Pos != (uint32_t)second[t][1]<<MOTION_PLAN_SHIFT ){
+					printf(" FAIL");
+					fail++;
+				}//end if
+			
+			}//end for
+			printf("\n");
+		
+		}//end for
+	}//end for
+	
+	return fail;
+
+}//end benchRetarget
+
+static int benchZero(void){
+/*	Desc:		Runs the zero length lead check.
+*	Ret:		Number of failures.
+*/
+
+	//Local variables
+	static const uint16_t	frameUs[]	= { 20000, 5000, 3000 };
+	MOTION_CH	*c		= &MotionCh[1];
+	int32_t		own		= 0;
+	uint8_t		busy;
+	uint8_t		at;
+	uint8_t		len;
+	uint8_t		run;
+	uint8_t		f;
+	int			fail	= 0;
+	
+	printf("zero length lead: channel 1 worst step change, x 1 us / frame, on its own and following\n");
+	for( f = 0; f < 3; f++ ){
+	
+		//On its own, then again up to the retarget
+		for( run = 0; run < 2; run++ ){
+		
+			benchSetup(frameUs[f], 0, 1500);
+			motionMoveTo(1, 2000, MOTION_PROFILE_TRAP);
+			motionService();
+			while( c->Pos < (1700UL<<MOTION_PLAN_SHIFT) )
+				benchFrame();
+			
+			if( !run ){
+				motionMoveTo(1, 1200, MOTION_PROFILE_TRAP);
+				motionService();
+				while( motionBusy(1) )
+					benchFrame();
+				own = BenchWorst[1];
+			}//end if
+		
+		}//end for
+		
+		//Channel 0 holds at its target, so its plan is empty
+		at		= MotionFrameCnt + MotionLead;
+		c->Goal	= 1200;
+		motionPlan(&MotionCh[0], FALSE, at, 0);
+		len		= MotionCh[0].Plan[MotionCh[0].PlanRun ^ 1].Len;
+		motionFollow(c, &MotionCh[0], at);
+		motionPublish(3, 0, at, &busy);
+		while( motionBusy(1) )
+			benchFrame();
+		
+		printf("  %3u Hz: %6.2f %6.2f", 1000000U / frameUs[f],
+			(double)own / (1<<MOTION_PLAN_SHIFT), (double)BenchWorst[1] / (1<<MOTION_PLAN_SHIFT));
+		if(		len
+			||	BenchWorst[1] > own
+			||	c->Pos != (1200UL<<MOTION_PLAN_SHIFT) ){
+			printf(" FAIL");
+			fail++;
+		}//end if
+		printf("\n");
+	
+	}//end for
+	
+	return fail;
+
+}//end benchZero
+
+int main(void){
+
+	//Local variables
+	int		fail;
+
+	fail  = benchRetarget();
+	fail += benchZero();
+
+	printf("%d failures\n", fail);
+
+	return fail ? 1 : 0;
+
+}//end main
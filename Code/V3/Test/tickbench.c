@@ -0,0 +1,131 @@
+/*	File:	tickbench.c
+*	Desc:	Host check of the TOC2 tick in timer.c against a model
+*			of Timer2.
+*	Proj:	AutoMotion
+*
+*	NOTES:
+*
+*		The model counts CPU clocks.  The Timer2 prescaler is a free
+*	running counter that PSR2 restarts, and TCNT2 counts on the tap
+*	CS22:0 picks.  On the count that TCNT2 leaves OCR2 the compare flag
+*	is set, and in CTC mode TCNT2 goes to 0 instead.  The ISR runs a
+*	pseudo random 5 to 100 us after the flag and calls
+*	timerTickElapsed() and timerSetNextTick() the way the TOC2 ISR in
+*	main.c does, for a next deadline of 1 to 40 ms.
+*
+*		At each compare MS_TIMER should be the time the model has run,
+*	give or take the first compare's offset, to within a TOC2 count.
+*	Over 10 minutes it reports how far the compares spread from it and
+*	the drift per 20 ms, and fails if the spread is ever a count or
+*	more.
+*/
+
+#include <stdio.h>
+#include "includes.h"
+
+void PWMFrameStart(void){
+}//end PWMFrameStart
+
+void motionFrame(void){
+}//end motionFrame
+
+#include "../Source/timer.c"
+
+#define BENCH_CLK_US	8
+#define BENCH_RUN_US	600000000LL
+
+static uint32_t		BenchSeed = 1;
+
+static uint32_t benchRand(uint32_t range){
+
+	BenchSeed = BenchSeed * 1103515245UL + 12345;
+	return (BenchSeed>>8) % range;
+
+}//end benchRand
+
+static uint16_t benchDiv(void){
+/*	Desc:		Prescaler TCCR2 picks.
+*	Ret:		CPU clocks per count.
+*/
+
+	static const uint16_t	div[8] = { 1, 1, 8, 32, 64, 128, 256, 1024 };
+
+	return div[TCCR2 & ( 1<<CS22 | 1<<CS21 | 1<<CS20 )];
+
+}//end benchDiv
+
+int main(void){
+
+	//Local variables
+	int64_t		clk		= 0;	//now, CPU clocks
+	int64_t		reset	= 0;	//prescaler restarted
+	int64_t		flag	= -1;	//compare flag set, -1 if clear
+	int64_t		isr		= 0;
+	int64_t		next;
+	int64_t		err;
+	int64_t		first	= 0;
+	int64_t		last	= 0;
+	int64_t		most	= 0;
+	int64_t		least	= 0;
+	uint32_t	ticks	= 0;
+	uint16_t	div;
+	int			fail	= 0;
+
+	TCNT2 = 0;
+	timerInit();
+
+	while( clk < BENCH_RUN_US * BENCH_CLK_US ){
+
+		//Next count, on the prescaler tap
+		div		= benchDiv();
+		next	= reset + ( ( clk - reset ) / div + 1 ) * div;
+
+		if( flag >= 0 && isr <= next ){
+
+			//The ISR, then the error at the compare, in us
+			clk = isr;
+			timerTickElapsed();
+			err = flag / BENCH_CLK_US - (int64_t)MS_TIMER * 1000;
+			SFIOR = 0;
+			timerSetNextTick(1 + benchRand(40));
+			if( SFIOR & ( 1<<PSR2 ) )
+				reset = clk;
+
+			if( !ticks++ )
+				first = err;
+			err -= first;
+			last = err;
+			if( err > most )
+				most = err;
+			if( err < least )
+				least = err;
+			if( most - least >= TOC2_CNT_US ){
+				if( fail++ < 5 )
+					printf("  FAIL: at %lld ms, the compare is %lld us from MS_TIMER\n",
+						(long long)(flag / BENCH_CLK_US / 1000), (long long)err);
+			}//end if
+			flag = -1;
+
+			continue;
+
+		}//end if
+
+		clk = next;
+		if( TCNT2 == OCR2 ){
+			flag	= clk;
+			isr		= clk + ( 5 + benchRand(96) ) * BENCH_CLK_US;
+			TCNT2	= ( TCCR2 & ( 1<<WGM21 ) ) ? 0 : TCNT2 + 1;
+		}//end if
+		else
+			TCNT2++;
+
+	}//end while
+
+	printf("%lu ticks over %lld s: compare %lld to %lld us past MS_TIMER, drift %.2f us / 20 ms\n",
+		(unsigned long)ticks, BENCH_RUN_US / 1000000, (long long)least, (long long)most,
+		(double)last * 20000 / BENCH_RUN_US);
+	printf("%d failures\n", fail);
+
+	return fail ? 1 : 0;
+
+}//end main